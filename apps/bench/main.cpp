@@ -0,0 +1,343 @@
+/**
+ * Benchmark of rasterizer kernels and surrounding I/O.
+ *
+ * Each benchmark is run a few times to warm up caches and branch predictors, then repeated for a fixed
+ * number of times. Median and median absolute deviation (MAD) of repetitions are reported as they're
+ * robust to outliers i.e. the thread being preempted, together with throughput in pixels or triangles
+ * per second based on the median.
+ *
+ * All inputs are generated from fixed seed, including meshes (see sr::generateMesh()) of which one is also
+ * written as .obj file for loader benchmark, so results are comparable across commits. Full scene is rendered
+ * with increasing number of triangles to show how performance scales. Results are written as JSON into
+ * the file given as the first argument (bench.json by default).
+ *
+ * Build with optimization flags as seen in Makefile, then run
+ *   ./bench [output.json]
+ */
+#include "SR_Common.h"
+#include <vector>
+#include <string>
+#include <cmath>
+#include <ctime>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <algorithm>
+
+#define FB_WIDTH 1024
+#define FB_HEIGHT 1024
+
+/// Fixed seed for all generated inputs
+#define BENCH_SEED 1
+
+/// Number of runs before measuring, and number of measured runs
+#define WARMUP_RUNS 3
+#define MEASURED_RUNS 15
+
+static const char* kMeshFile = "bench_mesh.obj";
+
+/// Number of triangles of scenes rendered from the smallest to the largest
+static const int kSceneSizes[] = { 1000, 10000, 100000, 1000000 };
+
+/// Statistics of a benchmark, times are in milliseconds
+struct BenchResult
+{
+    std::string name;
+    int runs;
+    double median;
+    double mad;
+    double min;
+    double max;
+    // work done in a single run
+    double items;
+    // unit of work i.e. "pixels", or "triangles"
+    const char* unit;
+};
+
+/// Return median of values, values are sorted in-place.
+static double median(std::vector<double>& values)
+{
+    std::sort(values.begin(), values.end());
+    const size_t n = values.size();
+    return n % 2 == 1 ? values[n/2] : 0.5 * (values[n/2 - 1] + values[n/2]);
+}
+
+/// Run `func` WARMUP_RUNS times then MEASURED_RUNS times measuring each run.
+///
+/// \param name Name of benchmark
+/// \param items Amount of work done by a single run, used to compute throughput
+/// \param unit Unit of work
+/// \param func Callable object doing a single run
+/// \return Statistics of measured runs
+template <typename Func>
+static BenchResult runBench(const char* name, double items, const char* unit, Func&& func)
+{
+    for (int i=0; i<WARMUP_RUNS; ++i)
+        func();
+
+    std::vector<double> times(MEASURED_RUNS);
+    for (int i=0; i<MEASURED_RUNS; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        func();
+        times[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    BenchResult r;
+    r.name = name;
+    r.runs = MEASURED_RUNS;
+    r.items = items;
+    r.unit = unit;
+    r.median = median(times);
+    r.min = times.front();
+    r.max = times.back();
+    std::vector<double> deviations(times.size());
+    for (size_t i=0; i<times.size(); ++i)
+        deviations[i] = std::abs(times[i] - r.median);
+    r.mad = median(deviations);
+
+    LOG("%-28s median %10.3f ms  MAD %8.3f ms  (%5.1f%%)  %12.3f M%s/s\n", name, r.median, r.mad,
+            r.median > 0.0 ? 100.0 * r.mad / r.median : 0.0, r.items / (r.median * 1e-3) * 1e-6, unit);
+    return r;
+}
+
+/// Write results as JSON, return false if it cannot be written.
+static bool writeJSON(const char* filename, const std::vector<BenchResult>& results)
+{
+    std::FILE* out = std::fopen(filename, "wb");
+    if (out == nullptr)
+    {
+        LOGE("Error attempting to open file %s for writing\n", filename);
+        return false;
+    }
+
+    std::fprintf(out, "{\n  \"timestamp\": %ld,\n  \"threads\": %u,\n  \"warmup_runs\": %d,\n  \"benchmarks\": [\n",
+            static_cast<long>(std::time(nullptr)), std::thread::hardware_concurrency(), WARMUP_RUNS);
+    for (size_t i=0; i<results.size(); ++i)
+    {
+        const BenchResult& r = results[i];
+        std::fprintf(out, "    {\"name\": \"%s\", \"runs\": %d, \"median_ms\": %.6f, \"mad_ms\": %.6f, \"min_ms\": %.6f, \"max_ms\": %.6f, "
+                "\"items\": %.0f, \"unit\": \"%s\", \"items_per_sec\": %.3f}%s\n",
+                r.name.c_str(), r.runs, r.median, r.mad, r.min, r.max, r.items, r.unit,
+                r.median > 0.0 ? r.items / (r.median * 1e-3) : 0.0, i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+
+    const bool ok = std::ferror(out) == 0;
+    std::fclose(out);
+    return ok;
+}
+
+/// Write mesh as .obj file with 1-based indices. Faces are written as v/vt/vn triplets as expected by ObjLoader,
+/// texture coordinate and normal indices repeat vertex index as they are ignored.
+static bool writeObj(const char* filename, const sr::ObjData& mesh)
+{
+    std::FILE* out = std::fopen(filename, "wb");
+    if (out == nullptr)
+        return false;
+    for (const sr::Vec3f& v : mesh.vertices)
+        std::fprintf(out, "v %f %f %f\n", v.x, v.y, v.z);
+    for (const std::vector<unsigned int>& f : mesh.faces)
+        std::fprintf(out, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", f[0] + 1, f[0] + 1, f[0] + 1, f[1] + 1, f[1] + 1, f[1] + 1, f[2] + 1, f[2] + 1, f[2] + 1);
+    const bool ok = std::ferror(out) == 0;
+    std::fclose(out);
+    return ok;
+}
+
+/// Convert from world coordinate to screen coordinate
+static inline sr::Vec4f toScreen(const sr::Vec3f& v)
+{
+    return sr::Vec4f((v.x + 1.0f) * FB_WIDTH/2.0f, (v.y + 1.0f) * FB_HEIGHT/2.0f, v.z, 1.0f);
+}
+
+/// Flat shading, intensity of each face is precomputed by sr::computeFaceIntensities().
+struct FlatShader : public sr::Shader<1>
+{
+    const sr::ObjData& mesh;
+    const std::vector<float>& faceIntensities;
+
+    FlatShader(const sr::ObjData& mesh_, const std::vector<float>& faceIntensities_)
+        : mesh(mesh_)
+        , faceIntensities(faceIntensities_)
+    {
+    }
+
+    inline void vertex(int face, int vert, sr::Vec4f& outPos, varyings_type& outVaryings)
+    {
+        outPos = toScreen(mesh.vertices[mesh.faces[face][vert]]);
+        outVaryings[0] = faceIntensities[face];
+    }
+
+    inline bool fragment(int, int, const varyings_type& varyings, sr::Color32i& outColor) const
+    {
+        const float c = varyings[0] * 255.0f;
+        outColor = sr::Color32i(c, c, c);
+        return true;
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    const char* outputFile = argc > 1 ? argv[1] : "bench.json";
+    std::vector<BenchResult> results;
+
+    sr::MathUtil::init(BENCH_SEED);
+    sr::FrameBuffer fb(FB_WIDTH, FB_HEIGHT);
+    sr::DepthBuffer zBuffer(FB_WIDTH, FB_HEIGHT);
+
+    // lines inside viewport, number of pixels of a line is its length along major axis
+    const int kNumLines = 10000;
+    std::vector<sr::Vec2i> lineEnds(kNumLines * 2);
+    double linePixels = 0.0;
+    for (int i=0; i<kNumLines; ++i)
+    {
+        lineEnds[i*2] = sr::Vec2i(sr::MathUtil::randInt(FB_WIDTH - 1), sr::MathUtil::randInt(FB_HEIGHT - 1));
+        lineEnds[i*2 + 1] = sr::Vec2i(sr::MathUtil::randInt(FB_WIDTH - 1), sr::MathUtil::randInt(FB_HEIGHT - 1));
+        linePixels += std::max(std::abs(lineEnds[i*2].x - lineEnds[i*2 + 1].x), std::abs(lineEnds[i*2].y - lineEnds[i*2 + 1].y)) + 1;
+    }
+    results.push_back(runBench("line", linePixels, "pixels", [&]() {
+        for (int i=0; i<kNumLines; ++i)
+            sr::line(lineEnds[i*2], lineEnds[i*2 + 1], fb, sr::Color32i(255, 255, 255));
+    }));
+
+    // small triangles of up to 32 pixels on each side, with random depth
+    const int kNumTriangles = 20000;
+    std::vector<sr::Vec2i> triVerts(kNumTriangles * 3);
+    std::vector<float> triDepths(kNumTriangles * 3);
+    for (int i=0; i<kNumTriangles; ++i)
+    {
+        const sr::Vec2i origin(sr::MathUtil::randInt(FB_WIDTH - 33), sr::MathUtil::randInt(FB_HEIGHT - 33));
+        const float depth = sr::MathUtil::randFloat();
+        for (int j=0; j<3; ++j)
+        {
+            triVerts[i*3 + j] = sr::Vec2i(origin.x + sr::MathUtil::randInt(32), origin.y + sr::MathUtil::randInt(32));
+            triDepths[i*3 + j] = depth;
+        }
+    }
+    results.push_back(runBench("triangle", kNumTriangles, "triangles", [&]() {
+        for (int i=0; i<kNumTriangles; ++i)
+            sr::triangle(triVerts[i*3], triVerts[i*3 + 1], triVerts[i*3 + 2], fb, sr::Color32i(255, 0, 0));
+    }));
+    results.push_back(runBench("triangle_zbuffer", kNumTriangles, "triangles", [&]() {
+        zBuffer.clear();
+        for (int i=0; i<kNumTriangles; ++i)
+            sr::triangle(triVerts[i*3], triVerts[i*3 + 1], triVerts[i*3 + 2], &triDepths[i*3], fb, zBuffer.getDepthBuffer(), sr::Color32i(0, 255, 0));
+    }));
+    sr::MSAABuffer msaa(FB_WIDTH, FB_HEIGHT);
+    results.push_back(runBench("triangle_msaa4x", kNumTriangles, "triangles", [&]() {
+        msaa.clear(0x0);
+        for (int i=0; i<kNumTriangles; ++i)
+            sr::triangle(triVerts[i*3], triVerts[i*3 + 1], triVerts[i*3 + 2], &triDepths[i*3], msaa, sr::Color32i(0, 0, 255));
+    }));
+
+    // bulk random numbers as used to generate scenes
+    const int kNumRandoms = 1 << 20;
+    std::vector<float> randomFloats(kNumRandoms);
+    std::vector<int> randomInts(kNumRandoms);
+    sr::Random random(BENCH_SEED);
+    results.push_back(runBench("random_fill_floats", kNumRandoms, "numbers", [&]() {
+        random.fillFloats(&randomFloats[0], kNumRandoms, -1.0f, 1.0f);
+    }));
+    results.push_back(runBench("random_fill_ints", kNumRandoms, "numbers", [&]() {
+        random.fillInts(&randomInts[0], kNumRandoms, 0, FB_WIDTH - 1);
+    }));
+
+    // normalizing vectors one by one, then 8 at a time in SoA form
+    std::vector<sr::Vec3f> vectors(kNumRandoms / 4);
+    std::vector<sr::Vec3f> normalized(vectors.size());
+    for (sr::Vec3f& v : vectors)
+        v = sr::Vec3f(random.nextFloat(-1.0f, 1.0f), random.nextFloat(-1.0f, 1.0f), random.nextFloat(-1.0f, 1.0f));
+    results.push_back(runBench("normalize_scalar", vectors.size(), "vectors", [&]() {
+        for (size_t i=0; i<vectors.size(); ++i)
+        {
+            sr::Vec3f v = vectors[i];
+            v.normalize();
+            normalized[i].x = v.x;
+            normalized[i].y = v.y;
+            normalized[i].z = v.z;
+        }
+    }));
+    results.push_back(runBench("normalize_x8", vectors.size(), "vectors", [&]() {
+        for (size_t i=0; i<vectors.size(); i+=sr::Vec3f_x8::kWidth)
+        {
+            sr::Vec3f_x8 v = sr::loadVec3fPacket<sr::Float_x8>(vectors, i);
+            v.normalize();
+            sr::storeVec3fPacket(v, normalized, i);
+        }
+    }));
+
+    // mesh is written once, then loaded repeatedly
+    sr::MeshGeneratorParams meshParams;
+    meshParams.numTriangles = 100000;
+    meshParams.seed = BENCH_SEED;
+    const sr::ObjData loaderMesh = sr::generateMesh(meshParams);
+    if (!writeObj(kMeshFile, loaderMesh))
+    {
+        LOGE("Failed to write %s\n", kMeshFile);
+        return 1;
+    }
+    {
+        sr::ObjData loaded;
+        if (!sr::ObjLoader::loadObjFile(kMeshFile, loaded) || loaded.faces.size() != loaderMesh.faces.size() || loaded.faces.back() != loaderMesh.faces.back())
+        {
+            LOGE("Loaded %s doesn't match generated mesh\n", kMeshFile);
+            return 1;
+        }
+    }
+    results.push_back(runBench("obj_load", loaderMesh.faces.size(), "triangles", [&]() {
+        sr::ObjData loaded;
+        if (!sr::ObjLoader::loadObjFile(kMeshFile, loaded))
+            LOGE("Failed to load %s\n", kMeshFile);
+    }));
+
+    // face normals once per mesh, then lighting of all faces as done whenever light changes.
+    // Light is from the viewer, also for scenes below.
+    sr::ObjData lightingMesh(loaderMesh);
+    std::vector<float> faceIntensities;
+    std::vector<unsigned int> faceColors;
+    const sr::Vec3f lightDirection(0.0f, 0.0f, 1.0f);
+    results.push_back(runBench("face_normals", lightingMesh.faces.size(), "triangles", [&]() {
+        lightingMesh.computeFaceNormals();
+    }));
+    results.push_back(runBench("face_lighting", lightingMesh.faces.size(), "triangles", [&]() {
+        sr::computeFaceIntensities(lightingMesh.faceNormals, lightDirection, faceIntensities);
+        sr::computeFaceColors(faceIntensities, sr::Color32i(255, 255, 255), faceColors);
+    }));
+
+    // full scene, clear then draw the whole mesh with depth test and back-face culling. Triangles of
+    // varying sizes are clustered over half of the screen with 4 layers on average.
+    for (int numTriangles : kSceneSizes)
+    {
+        sr::MeshGeneratorParams sceneParams;
+        sceneParams.numTriangles = numTriangles;
+        sceneParams.coverage = 0.5f;
+        sceneParams.depthComplexity = 4.0f;
+        sceneParams.sizeDistribution = sr::SizeDistribution::LOG_UNIFORM;
+        sceneParams.minSizeRatio = 0.01f;
+        sceneParams.numClusters = 16;
+        sceneParams.seed = BENCH_SEED;
+        const sr::ObjData scene = sr::generateMesh(sceneParams);
+        sr::computeFaceIntensities(scene.faceNormals, lightDirection, faceIntensities);
+
+        FlatShader shader(scene, faceIntensities);
+        const std::string name = "scene_" + std::to_string(numTriangles);
+        results.push_back(runBench(name.c_str(), scene.faces.size(), "triangles", [&]() {
+            std::fill(fb.getFrameBuffer(), fb.getFrameBuffer() + FB_WIDTH * FB_HEIGHT, 0xFF000000);
+            zBuffer.clear();
+            sr::drawTriangles(shader, scene.faces.size(), fb, zBuffer.getDepthBuffer(), sr::CullMode::BACK);
+        }));
+    }
+
+    // written image is the last rendered scene, check it when numbers look suspicious
+    results.push_back(runBench("tga_write24", FB_WIDTH * FB_HEIGHT, "pixels", [&]() {
+        sr::TGAImage::write24("bench.tga", fb);
+    }));
+
+    if (!writeJSON(outputFile, results))
+    {
+        LOGE("Failed to write %s\n", outputFile);
+        return 1;
+    }
+    LOG("Results are written into %s\n", outputFile);
+    return 0;
+}
@@ -12,28 +12,68 @@
  * Tested on Intel(R) Core(TM) i5-3210M CPU @ 2.50GHz, 2 cores, 2 threads each, Ubuntu 18.04 with
  * optimized compilation flags as seen in Makefile.
  *
- * It took around ~65 ms (so around 15 fps) for rectangular shape, but for circle, this increases to
- * ~78 ms. This shows impact from branching within tight loop (see branch prediction for more information)
- * 
+ * Circles are rasterized span by span, only the width of each span is computed per row so there is no
+ * per-pixel branch. Set CIRCLE_SHAPE to 0 to render squares of the same bounding box instead, then compare
+ * time, IPC and branch misses of "raster" zone of both shapes with HARDWARE_COUNTERS to measure the cost
+ * of the shape itself.
+ *
  * The tasks to complete are as follows
  *  - sorting all circles according to its z value
  *  - distribute works across multiple threads (4 threads)
- *  - render works from all threads
- *  - combine the works from all threads
+ *  - render works from all threads, each thread renders directly into its own region of the framebuffer
  * *doesn't include time in writing out to .tga file.
  *
+ * Framebuffer is 8x8 tiled (see TILED_FRAMEBUFFER) so pixels of a circle span less cache lines, and
+ * no per-thread tile copy has to be combined back afterwards. It's resolved into row-major order only
+ * when written out.
+ *
  * Serial implementation took ~105 ms which is doubled from multithreading implementation. Seems
  * reasonable. If machine has more core, it would be performing better.
+ *
+ * Each phase (sort, bin, raster, and output) is measured as profile zone per thread, and reported at
+ * the end with min/mean/p99 of each zone (see SR_PROFILE_ZONE()). Zones are also written into trace.json
+ * which can be opened in chrome://tracing or Perfetto UI to see gaps between phases on each thread.
+ * With HARDWARE_COUNTERS, each zone also reports cycles, IPC, cache misses, and branch misses of its phase
+ * (needs kernel.perf_event_paranoid <= 2 on Linux), so "raster" zone counts the whole raster loop of a thread.
+ * Zones are per phase rather than per circle, as reading counters costs system calls which would distort
+ * timing of the raster loop.
  */
 #include "SR_Common.h"
 #include <vector>
 #include <cmath>
 #include <thread>
-#include <cstring>
+#include <cstdio>
 
 /// Screen size. For this implementation supports only squared size.
 #define SIZE 1024
 
+/// Define to 1 to render into 8x8 tiled framebuffer, or 0 for row-major framebuffer
+#define TILED_FRAMEBUFFER 1
+
+#if TILED_FRAMEBUFFER == 1
+typedef sr::FrameBufferT<sr::TiledLayout<8>> TargetFrameBuffer;
+// pixels are contiguous only within a row of a tile
+static const int kContiguousMask = TargetFrameBuffer::layout_type::kTileMask;
+#else
+typedef sr::FrameBuffer TargetFrameBuffer;
+static const int kContiguousMask = SIZE - 1;
+#endif
+
+/// Define to 1 to render translucent circles blended over each other (source-over), or 0 for opaque circles
+#define TRANSLUCENT_CIRCLES 0
+
+#if TRANSLUCENT_CIRCLES == 1
+static const sr::BlendMode kCircleBlendMode = sr::BlendMode::SRC_OVER;
+#else
+static const sr::BlendMode kCircleBlendMode = sr::BlendMode::REPLACE;
+#endif
+
+/// Define to 1 to render circles, or 0 to render squares bounding them to compare against
+#define CIRCLE_SHAPE 1
+
+/// Define to 1 to capture hardware performance counters per profile zone, or 0 to only time zones
+#define HARDWARE_COUNTERS 0
+
 /// Pixel format is 32-bit little-endian ARGB
 static sr::Color32i white = sr::makeColor32i(255, 255, 255);
 static sr::Color32i green = sr::makeColor32i(0, 255, 0);
@@ -95,7 +135,8 @@ struct __attribute__((aligned(64))) Circle
     {
     }
 };
-std::vector<Circle> circles;
+// std::allocator doesn't respect alignment of Circle (prior to C++17), so use aligned allocator
+sr::AlignedVector<Circle> circles;
 
 struct TileIndex
 {
@@ -109,9 +150,9 @@ struct TileIndex
     }
 };
 
+/// Region of the framebuffer owned by a single thread
 struct Tile
 {
-    std::vector<unsigned int> color;
     Region region;
     int xIndex;
     int yIndex;
@@ -125,7 +166,7 @@ Tile tiles[AVAILABLE_NUM_THREADS];
 
 // Distributed works for all cores. Chosen to duplicates Circle element instead of using indexing
 // to increase performance in cache accessing.
-std::vector<Circle> distributedWorks[AVAILABLE_NUM_THREADS];
+sr::AlignedVector<Circle> distributedWorks[AVAILABLE_NUM_THREADS];
 
 /// Generate random circles then add into input circles
 /// Input `numCircles` for number of circles to be generated.
@@ -133,7 +174,7 @@ std::vector<Circle> distributedWorks[AVAILABLE_NUM_THREADS];
 /// \param circles std::vector of Circle, this will be updated in-place.
 /// \param numCircles Total number of circles to generate.
 ///
-void generateCircles(std::vector<Circle>& circles, const int numCircles)
+void generateCircles(sr::AlignedVector<Circle>& circles, const int numCircles)
 {
     for (int i=0; i<numCircles; ++i)
     {
@@ -142,14 +183,18 @@ void generateCircles(std::vector<Circle>& circles, const int numCircles)
                     sr::MathUtil::randInt2(0, SIZE),
                     sr::MathUtil::randInt2(50, 60),
                     sr::MathUtil::randInt2(1,30),
+#if TRANSLUCENT_CIRCLES == 1
+                    sr::Color32i(sr::MathUtil::randInt(255), sr::MathUtil::randInt(255), sr::MathUtil::randInt(255), sr::MathUtil::randInt2(64, 192)))
+#else
                     sr::makeColor32i(sr::MathUtil::randInt(255), sr::MathUtil::randInt(255), sr::MathUtil::randInt(255)))
+#endif
                 );
     }
 }
 
 /// We don't have z-buffer in this case, so we use painter algorithm sorting from far to near.
 /// This is a compare function used with std::sort
-void sortCirclesFarToNear(std::vector<Circle>& circles)
+void sortCirclesFarToNear(sr::AlignedVector<Circle>& circles)
 {
     std::sort(circles.begin(), circles.end(), [](const Circle& a, const Circle& b) -> bool {
             return a.z > b.z;
@@ -171,15 +216,12 @@ void computeNumTilesFromNumThreads(int nThreads, int& outNumTiles1D, int& outNum
 }
 
 /// Assume tile is squared.
-/// Return lineSize
 ///
-/// \param tiles Tiles as pre-declared with maximum of AVAILABLE_NUM_THREADS as hinted. These will be prepared to be allocated for total number of pixels to support in rendering for each tile.
+/// \param tiles Tiles as pre-declared with maximum of AVAILABLE_NUM_THREADS as hinted. Region of each tile will be set.
 /// \param nTiles1D Total number of tiles along 1 dimension
-/// \return Line size of each tile which is width of each tile.
-int preAllocateSpaceForTiles(Tile tiles[AVAILABLE_NUM_THREADS], const int nTiles1D)
+void setupTiles(Tile tiles[AVAILABLE_NUM_THREADS], const int nTiles1D)
 {
     const int kNumSize1D = std::floor(SIZE / nTiles1D);
-    const int kPreAllocatedSize = kNumSize1D * kNumSize1D;
     for (int j=0; j<nTiles1D; ++j)
     {
         for (int i=0; i<nTiles1D; ++i)
@@ -187,12 +229,9 @@ int preAllocateSpaceForTiles(Tile tiles[AVAILABLE_NUM_THREADS], const int nTiles
             const int tileIndex = i + j*nTiles1D;
             tiles[tileIndex].xIndex = i;
             tiles[tileIndex].yIndex = j;
-            tiles[tileIndex].color.resize(kPreAllocatedSize, 0xFF000000);     // initially set to opaque black color
             tiles[tileIndex].region = Region(kNumSize1D * i, kNumSize1D * j, kNumSize1D, kNumSize1D);
         }
     }
-
-    return kNumSize1D;
 }
 
 /// Determine tile-index from input position in screen-space for total number of tiles in 1 dimension
@@ -224,7 +263,7 @@ TileIndex determineTileIndex(int x, int y, int nTiles1D)
 /// \param tile Tile to get the works for this distribution
 /// \param nTiles1D Number of tiles along 1 dimension.
 ///
-void distributeWorksForTile(const std::vector<Circle>& circles, std::vector<Circle>& distributedWorks, Tile& tile)
+void distributeWorksForTile(const sr::AlignedVector<Circle>& circles, sr::AlignedVector<Circle>& distributedWorks, Tile& tile)
 {
     Region region = tile.region;
 
@@ -246,98 +285,93 @@ void distributeWorksForTile(const std::vector<Circle>& circles, std::vector<Circ
 }
 
 
-///  Rasterize input Circle
+///  Rasterize input Circle span by span, each span is blended with kCircleBlendMode.
+///  With CIRCLE_SHAPE 0, the square bounding the circle is rasterized instead.
 ///
 /// \param c Input Circle to rasterize
-/// \param tile Target tile to render onto
-/// \param lineSize LineSize which is width of each tile
-void rasterize(const Circle& c, Tile& tile, const int lineSize)
+/// \param tile Tile whose region is rendered, pixels outside of it are owned by other threads
+/// \param fb Target framebuffer to render onto
+void rasterize(const Circle& c, const Tile& tile, TargetFrameBuffer& fb)
 {
-    const int tileOffsetX = tile.region.x0;
-    const int tileOffsetY = tile.region.y0;
-
     const int centerX = c.x;
     const int centerY = c.y;
     const int radius = c.radius;
+#if CIRCLE_SHAPE == 1
     const int squaredRadius = radius * radius;
+#endif
 
-    const int startX = centerX - radius;
-    const int startY = centerY - radius;
+    // clip bounding box of circle against region of this tile, x1 and y1 are exclusive
+    const Region region = tile.region;
+    const int startX = std::max(centerX - radius, region.x0);
+    const int startY = std::max(centerY - radius, region.y0);
+    const int endX = std::min(centerX + radius, region.x1 - 1);
+    const int endY = std::min(centerY + radius, region.y1 - 1);
 
-    const int endX = centerX + radius;
-    const int endY = centerY + radius;
+    const TargetFrameBuffer::layout_type& layout = fb.getLayout();
+    unsigned int* pixels = fb.getFrameBuffer();
 
-    const Region region = tile.region;
-    
     for (int y=startY; y<=endY; ++y)
     {
-        for (int x=startX; x<=endX; ++x)
+#if CIRCLE_SHAPE == 1
+        // half width of the span, the greatest dx such that dx*dx + dy*dy <= squaredRadius
+        const int dy = y - centerY;
+        const int remaining = squaredRadius - dy*dy;
+        int halfWidth = static_cast<int>(std::sqrt(static_cast<float>(remaining)));
+        while (halfWidth*halfWidth > remaining)
+            --halfWidth;
+        while ((halfWidth+1)*(halfWidth+1) <= remaining)
+            ++halfWidth;
+#else
+        const int halfWidth = radius;
+#endif
+
+        const int spanEndX = std::min(centerX + halfWidth, endX) + 1;
+        for (int x=std::max(centerX - halfWidth, startX); x<spanEndX; )
         {
-            if (x < region.x0 || x > region.x1)
-                continue;
-            if (y < region.y0 || y > region.y1)
-                continue;
-
-            const int dx = x - centerX;
-            const int dy = y - centerY;
-            if (dx*dx + dy*dy > squaredRadius)
-                continue;
-
-            // take into account region offset of this particular tile
-            // as tile doesn't have full final framebuffer size
-            const int fbIndex = (x-tileOffsetX) + (y-tileOffsetY)*lineSize;
-            
-            tile.color[fbIndex] = c.color.packed;
+            // span is split where it's not contiguous in memory
+            const int count = std::min(spanEndX, (x | kContiguousMask) + 1) - x;
+            sr::blendSpan(kCircleBlendMode, c.color.packed, &pixels[layout.index(x, y)], count);
+            x += count;
         }
     }
 }
 
-/// Perform render work from input `works` which consists of Circles to render, output resultant frameBuffer into `tile`.
+/// Perform render work from input `works` which consists of Circles to render, output into region of `tile` in framebuffer.
 ///
 /// \param works Array of Circle to render
-/// \param tile Target framebuffer to render onto
-/// \param lineSize Width of a single tile
-void renderWork(const std::vector<Circle>& works, Tile& tile, const int lineSize)
+/// \param tile Tile to render
+/// \param fb Target framebuffer to render onto
+void renderWork(const sr::AlignedVector<Circle>& works, const Tile& tile, TargetFrameBuffer& fb)
 {
+    SR_PROFILE_ZONE("raster");
     for (const Circle& c: works)
     {
-        rasterize(c, tile, lineSize);
-    }
-}
-
-/// Combine work from input tile then output into target framebuffer
-void combineWork(const Tile& tile, sr::FrameBuffer& fb)
-{
-    unsigned int* fbPtr = fb.getFrameBuffer();
-    
-    const int dstStartX = tile.region.x0;
-    const int dstStartY = tile.region.y0;
-    const int dstWidth = fb.getWidth();
-
-    const int kTileSize = tile.region.width;
-
-    // copy row by row from source to destination
-    for (int y=0; y<kTileSize; ++y)
-    {
-        const int dstIndex = dstStartX + (dstStartY+y)*dstWidth;
-        const int srcIndex = y*kTileSize;
-        std::memcpy(&fbPtr[dstIndex], &tile.color[srcIndex], sizeof(decltype(tile.color)::value_type) * kTileSize);
+        rasterize(c, tile, fb);
     }
 }
 
 int main()
 {
     sr::MathUtil::init();
-    sr::FrameBuffer fb(1024, 1024);
+    // initially set to opaque black color, cleared by all threads so pages are first-touched by them
+    TargetFrameBuffer fb(SIZE, SIZE, 0xFF000000, AVAILABLE_NUM_THREADS);
 
     int numTiles;
     int numTiles1D;
     computeNumTilesFromNumThreads(AVAILABLE_NUM_THREADS, numTiles1D, numTiles);
-    const int lineSize = preAllocateSpaceForTiles(tiles, numTiles1D);
+    setupTiles(tiles, numTiles1D);
     generateCircles(circles, 5000);
 
+#if HARDWARE_COUNTERS == 1
+    sr::Profile::enableCounters();
+#endif
+    sr::Profile::setThreadName("main");
+    sr::Profile::markFrame();
     sr::Profile::start();
-    sortCirclesFarToNear(circles);
+    {
+        SR_PROFILE_ZONE("sort");
+        sortCirclesFarToNear(circles);
+    }
 
     std::thread ts[AVAILABLE_NUM_THREADS];
 
@@ -348,6 +382,10 @@ int main()
     // an entire array of circles.
     for (int i=0; i<AVAILABLE_NUM_THREADS; ++i)
         ts[i] = std::thread([numTiles1D, i](){
+            char name[16];
+            std::snprintf(name, sizeof(name), "bin worker %d", i);
+            sr::Profile::setThreadName(name);
+            SR_PROFILE_ZONE("bin");
             distributeWorksForTile(circles, distributedWorks[i], tiles[i]);
         });
     for (int i=0; i<AVAILABLE_NUM_THREADS; ++i)
@@ -367,22 +405,23 @@ int main()
 #endif
 
     // render works
-    for (int i=0; i<AVAILABLE_NUM_THREADS; ++i)
-        ts[i] = std::thread([lineSize](int i){
-            renderWork(distributedWorks[i], tiles[i], lineSize);
-        }, i);
-    for (int i=0; i<AVAILABLE_NUM_THREADS; ++i)
-        ts[i].join();
-
-    // combine works
+    // Each thread writes only pixels in region of its own tile, so nothing has to be combined afterwards.
     for (int i=0; i<AVAILABLE_NUM_THREADS; ++i)
         ts[i] = std::thread([&fb](int i){
-            combineWork(tiles[i], fb);           
+            char name[16];
+            std::snprintf(name, sizeof(name), "raster worker %d", i);
+            sr::Profile::setThreadName(name);
+            renderWork(distributedWorks[i], tiles[i], fb);
         }, i);
     for (int i=0; i<AVAILABLE_NUM_THREADS; ++i)
         ts[i].join();
     sr::Profile::endAndPrint();
 
-    sr::TGAImage::write24("out.tga", fb, true);
+    {
+        SR_PROFILE_ZONE("output");
+        sr::TGAImage::write24("out.tga", fb, true);
+    }
+    sr::Profile::report();
+    sr::Profile::writeChromeTrace("trace.json");
     return 0;
 }
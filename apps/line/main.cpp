@@ -4,7 +4,7 @@
 #include <cmath>
 #include <algorithm>
 
-// define line implementation to choose 1-7
+// define line implementation to choose 1-7, or 8 for anti-aliased line from common/
 #define LINE_IMPL 7
 
 // Floating-point operation (multiplication, and rounding), and the choice of constant stepping value
@@ -228,6 +228,10 @@ int main()
     line7(sr::Vec2i(13, 20), sr::Vec2i(80, 40), fb, sr::makeColorARGB(255, 255, 255));
     line7(sr::Vec2i(20, 13), sr::Vec2i(40, 80), fb, sr::makeColorARGB(255, 0, 0));
     line7(sr::Vec2i(80, 40), sr::Vec2i(13, 20), fb, sr::makeColorARGB(255, 0, 0));
+#elif LINE_IMPL == 8
+    sr::lineAA(sr::Vec2f(13, 20), sr::Vec2f(80, 40), fb, sr::Color32i(255, 255, 255));
+    sr::lineAA(sr::Vec2f(20, 13), sr::Vec2f(40, 80), fb, sr::Color32i(255, 0, 0));
+    sr::lineAA(sr::Vec2f(80, 40), sr::Vec2f(13, 20), fb, sr::Color32i(255, 0, 0));
 #endif
     sr::Profile::endAndPrint();
 
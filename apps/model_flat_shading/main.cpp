@@ -1,14 +1,147 @@
 #include "SR_Common.h"
 #include <algorithm>
+#include <vector>
 
 #define FB_WIDTH 512
 #define FB_HEIGHT 512
 
+// define shading implementation to choose
+// 1 - flat shading, intensity per face
+// 2 - Gouraud shading, intensity per vertex from averaged face normals then interpolated
+// 3 - deferred shading, interpolated normals are rasterized into G-buffer then lit once per pixel
+// 4 - deferred shading with multiple colored lights accumulated in HDR framebuffer, then tonemapped
+// 5 - translucent Gouraud shading of all faces with weighted blended order-independent transparency, no sorting
+#define SHADING_IMPL 1
+
+// build with -DSR_RASTER_STATS=1 added to CXXFLAGS in Makefile to print rasterization counters,
+// and write overdraw heatmap into overdraw.tga
+
 static sr::Color32i white = sr::makeColor32i(255, 255, 255);
 static sr::Color32i green = sr::makeColor32i(0, 255, 0);
 static sr::Color32i red = sr::makeColor32i(255, 0, 0);
 static sr::Vec3f sLightDirection = sr::Vec3f(0.0f, 0.0f, 1.0f);
 
+/// Convert from world coordinate to screen coordinate
+static inline sr::Vec4f toScreen(const sr::Vec3f& worldCoord)
+{
+    return sr::Vec4f((worldCoord.x + 1.0f) * FB_WIDTH/2.0f, (worldCoord.y + 1.0f) * FB_HEIGHT/2.0f, worldCoord.z, 1.0f);
+}
+
+/// Compute vertex normal as average of normals of faces sharing such vertex
+static std::vector<sr::Vec3f> computeVertexNormals(const sr::ObjData& model)
+{
+    std::vector<sr::Vec3f> vertexNormals(model.vertices.size());
+    for (const std::vector<unsigned int>& f : model.faces)
+    {
+        const sr::Vec3f& v0 = model.vertices[f[0]];
+        const sr::Vec3f faceNormal = sr::cross(model.vertices[f[1]] - v0, model.vertices[f[2]] - v0);
+        for (int j=0; j<3; ++j)
+            vertexNormals[f[j]] = vertexNormals[f[j]] + faceNormal;
+    }
+
+    for (sr::Vec3f& n : vertexNormals)
+    {
+        if (n.squaredLength() > 0.0f)
+            n.normalize();
+    }
+    return vertexNormals;
+}
+
+/// Flat shading, lighting intensity is precomputed per face (see sr::computeFaceIntensities()) then carried as constant varying.
+struct FlatShader : public sr::Shader<1>
+{
+    const sr::ObjData& model;
+    const std::vector<float>& faceIntensities;
+
+    FlatShader(const sr::ObjData& model_, const std::vector<float>& faceIntensities_)
+        : model(model_)
+        , faceIntensities(faceIntensities_)
+    {
+    }
+
+    inline void vertex(int face, int vert, sr::Vec4f& outPos, varyings_type& outVaryings)
+    {
+        outPos = toScreen(model.vertices[model.faces[face][vert]]);
+        outVaryings[0] = faceIntensities[face];
+    }
+
+    inline bool fragment(int, int, const varyings_type& varyings, sr::Color32i& outColor) const
+    {
+        const float applyIntensity = varyings[0] * 255;
+        outColor = sr::Color32i(applyIntensity, applyIntensity, applyIntensity);
+        return true;
+    }
+};
+
+/// Gouraud shading, lighting intensity is computed per vertex then interpolated across the face.
+struct GouraudShader : public sr::Shader<1>
+{
+    const sr::ObjData& model;
+    std::vector<float> vertexIntensities;
+    unsigned char alpha;
+
+    GouraudShader(const sr::ObjData& model_, unsigned char alpha_=255)
+        : model(model_)
+        , alpha(alpha_)
+    {
+        const std::vector<sr::Vec3f> vertexNormals = computeVertexNormals(model);
+        vertexIntensities.resize(model.vertices.size());
+        for (size_t i=0; i<vertexNormals.size(); ++i)
+            vertexIntensities[i] = std::max(0.0f, sr::dot(vertexNormals[i], sLightDirection));
+    }
+
+    inline void vertex(int face, int vert, sr::Vec4f& outPos, varyings_type& outVaryings)
+    {
+        const unsigned int index = model.faces[face][vert];
+        outPos = toScreen(model.vertices[index]);
+        outVaryings[0] = vertexIntensities[index];
+    }
+
+    inline bool fragment(int, int, const varyings_type& varyings, sr::Color32i& outColor) const
+    {
+        const float applyIntensity = varyings[0] * 255;
+        outColor = sr::Color32i(applyIntensity, applyIntensity, applyIntensity, alpha);
+        return true;
+    }
+};
+
+/// Directional light whose color intensity can be greater than 1.0
+struct DirectionalLight
+{
+    sr::Vec3f direction;
+    sr::Color32f color;
+};
+
+/// Visibility pass of deferred shading, only interpolates vertex normals into G-buffer.
+/// Lighting is done later once per pixel.
+struct DeferredShader : public sr::Shader<3>
+{
+    const sr::ObjData& model;
+    std::vector<sr::Vec3f> vertexNormals;
+
+    DeferredShader(const sr::ObjData& model_)
+        : model(model_)
+        , vertexNormals(computeVertexNormals(model_))
+    {
+    }
+
+    inline void vertex(int face, int vert, sr::Vec4f& outPos, varyings_type& outVaryings)
+    {
+        const unsigned int index = model.faces[face][vert];
+        outPos = toScreen(model.vertices[index]);
+        outVaryings[0] = vertexNormals[index].x;
+        outVaryings[1] = vertexNormals[index].y;
+        outVaryings[2] = vertexNormals[index].z;
+    }
+
+    inline bool surface(int, int, const varyings_type& varyings, sr::Vec3f& outNormal, unsigned int& outMaterial) const
+    {
+        outNormal = sr::Vec3f(varyings[0], varyings[1], varyings[2]);
+        outMaterial = 0;
+        return true;
+    }
+};
+
 int main()
 {
     sr::MathUtil::init();
@@ -24,40 +157,70 @@ int main()
     LOG("  number of vertices: %d\n", headModel.vertices.size());
     LOG("  number of faces: %d\n", headModel.faces.size());
 
-    // do flat shading on model's triangles
-    const auto& modelFaces = headModel.faces;
-    const auto& modelVertices = headModel.vertices;
-    const int kNumModelFaces = modelFaces.size();
+    sr::DepthBuffer zBuffer(FB_WIDTH, FB_HEIGHT);
 
-    for (int i=0; i<kNumModelFaces; ++i)
-    {
-        auto& face = modelFaces[i];
-        sr::Vec2i screenCoords[3];
-        sr::Vec3f worldCoords[3];
+#if SR_RASTER_STATS == 1
+    sr::OverdrawMap overdraw(FB_WIDTH, FB_HEIGHT);
+    sr::setThreadOverdrawMap(&overdraw);
+#endif
 
-        // convert from world coordinate to screen coordinate
-        for (int j=0; j<3; ++j)
-        {
-            sr::Vec3f worldCoord = modelVertices[face[j]];
-            screenCoords[j] = sr::Vec2i((worldCoord.x + 1.0f) * FB_WIDTH/2.0f, (worldCoord.y + 1.0f) * FB_HEIGHT/2.0f);
-            worldCoords[j] = worldCoord;
-        }
+    // light direction is the same as view direction, so faces facing away from the light are back faces
+#if SHADING_IMPL == 1
+    // face normals are computed at load, only lighting is evaluated per render
+    std::vector<float> faceIntensities;
+    sr::computeFaceIntensities(headModel.faceNormals, sLightDirection, faceIntensities);
+    FlatShader shader(headModel, faceIntensities);
+    sr::drawTriangles(shader, headModel.faces.size(), fb, zBuffer.getDepthBuffer(), sr::CullMode::BACK);
+#elif SHADING_IMPL == 2
+    GouraudShader shader(headModel);
+    sr::drawTriangles(shader, headModel.faces.size(), fb, zBuffer.getDepthBuffer(), sr::CullMode::BACK);
+#elif SHADING_IMPL == 3
+    const unsigned int materialAlbedos[] = { white.packed };
+    sr::GBuffer gbuffer(FB_WIDTH, FB_HEIGHT);
+    DeferredShader shader(headModel);
+    sr::drawTrianglesGBuffer(shader, headModel.faces.size(), gbuffer, sr::CullMode::BACK);
+    sr::shadeLambert(gbuffer, materialAlbedos, sLightDirection, fb);
+#elif SHADING_IMPL == 4
+    const DirectionalLight lights[] = {
+        { sLightDirection, sr::Color32f(1.5f, 1.5f, 1.5f) },
+        { sr::Vec3f(0.7071f, 0.0f, 0.7071f), sr::Color32f(2.0f, 0.4f, 0.2f) },
+        { sr::Vec3f(-0.7071f, 0.0f, 0.7071f), sr::Color32f(0.2f, 0.6f, 2.0f) }
+    };
+    sr::GBuffer gbuffer(FB_WIDTH, FB_HEIGHT);
+    DeferredShader shader(headModel);
+    sr::drawTrianglesGBuffer(shader, headModel.faces.size(), gbuffer, sr::CullMode::BACK);
 
-        // assume model is exported with right-hand rule (counter-clockwise) triangle
-        // compute normal vector this face
-        sr::Vec3f faceNormal = sr::cross(worldCoords[1] - worldCoords[0], worldCoords[2] - worldCoords[0]);
-        // normalize normal vector
-        faceNormal.normalize();
-
-        // check lighting effect on this face using dot product
-        float intensity = sr::dot(faceNormal, sLightDirection);
-        if (intensity > 0.0f)
+    // accumulate lighting without clamping, overlapping lights go beyond 1.0
+    sr::HDRFrameBuffer hdr(FB_WIDTH, FB_HEIGHT);
+    const unsigned int* surface = gbuffer.getSurface();
+    for (int i=0; i<FB_WIDTH*FB_HEIGHT; ++i)
+    {
+        if (sr::GBuffer::unpackMaterial(surface[i]) == sr::GBuffer::kNoMaterial)
+            continue;
+        const sr::Vec3f normal = sr::GBuffer::unpackNormal(surface[i]);
+        hdr[i].a = 1.0f;
+        for (const DirectionalLight& light : lights)
         {
-            float applyIntensity = intensity * 255;
-            sr::triangle(screenCoords[0], screenCoords[1], screenCoords[2], fb,
-                sr::Color32i(applyIntensity, applyIntensity, applyIntensity));
+            const float intensity = std::max(0.0f, sr::dot(normal, light.direction));
+            hdr.add(i % FB_WIDTH, i / FB_WIDTH, sr::Color32f(light.color.r * intensity, light.color.g * intensity, light.color.b * intensity, 0.0f));
         }
     }
+    sr::resolveHDR(hdr, fb);
+#elif SHADING_IMPL == 5
+    // back faces are visible through front faces, and all are accumulated in any order
+    GouraudShader shader(headModel, 96);
+    sr::OITBuffer oit(FB_WIDTH, FB_HEIGHT, 1.0f, -1.0f);
+    sr::drawTrianglesOIT(shader, headModel.faces.size(), oit, zBuffer.getDepthBuffer());
+    sr::resolveOIT(oit, fb);
+#endif
+
+#if SR_RASTER_STATS == 1
+    sr::setThreadOverdrawMap(nullptr);
+    sr::printRasterStats(sr::collectRasterStats());
+    sr::FrameBuffer heatmap(FB_WIDTH, FB_HEIGHT);
+    sr::overdrawHeatmap(overdraw, heatmap);
+    sr::TGAImage::write24("overdraw.tga", heatmap);
+#endif
 
     sr::TGAImage::write24("out.tga", fb);
     return 0;
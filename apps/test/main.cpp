@@ -1,6 +1,88 @@
 #include "SR_Common.h"
 #include <vector>
+#include <algorithm>
 #include <cassert>
+#include <thread>
+#include <limits>
+
+/// Triangles of constant color with screen space positions given as 3 per face.
+struct ConstantShader : public sr::Shader<0>
+{
+    const sr::Vec4f* positions;
+
+    ConstantShader(const sr::Vec4f* positions_)
+        : positions(positions_)
+    {
+    }
+
+    inline void vertex(int face, int vert, sr::Vec4f& outPos, varyings_type&)
+    {
+        outPos = positions[face*3 + vert];
+    }
+
+    inline bool fragment(int, int, const varyings_type&, sr::Color32i& outColor) const
+    {
+        outColor = sr::Color32i(255, 0, 0);
+        return true;
+    }
+};
+
+/// Triangles whose color is chosen by face index, with screen space positions given as 3 per face.
+struct FaceColorShader : public sr::Shader<1>
+{
+    const sr::Vec4f* positions;
+
+    FaceColorShader(const sr::Vec4f* positions_)
+        : positions(positions_)
+    {
+    }
+
+    inline void vertex(int face, int vert, sr::Vec4f& outPos, varyings_type& outVaryings)
+    {
+        outPos = positions[face*3 + vert];
+        outVaryings[0] = static_cast<float>(face);
+    }
+
+    inline bool fragment(int, int, const varyings_type& varyings, sr::Color32i& outColor) const
+    {
+        const int face = static_cast<int>(varyings[0] + 0.5f);
+        outColor = sr::Color32i(40 * (face + 1), 255 - 40 * face, 0);
+        return true;
+    }
+};
+
+/// Bresenham line plotting every pixel with bounds check, as reference for sr::line().
+static void referenceLine(sr::Vec2i start, sr::Vec2i end, sr::FrameBuffer& fb, unsigned int color)
+{
+    const bool steep = std::abs(start.x - end.x) < std::abs(start.y - end.y);
+    if (steep)
+    {
+        std::swap(start.x, start.y);
+        std::swap(end.x, end.y);
+    }
+    if (start.x > end.x)
+    {
+        std::swap(start.x, end.x);
+        std::swap(start.y, end.y);
+    }
+    const int dx = end.x - start.x;
+    const int D = std::abs(2*(end.y - start.y));
+    const int yStep = end.y > start.y ? 1 : -1;
+    int error = 0;
+    for (int x=start.x, y=start.y; x<=end.x; ++x)
+    {
+        if (steep)
+            fb.set(y, x, color);
+        else
+            fb.set(x, y, color);
+        error += D;
+        if (error > dx)
+        {
+            y += yStep;
+            error -= 2*dx;
+        }
+    }
+}
 
 int main()
 {
@@ -11,6 +93,19 @@ int main()
     LOGE_BLUE("Log error - Blue\n");
     LOGA("Log (thread-safe)\n");
     LOGA_CYAN("Log (thread-safe) - Magenta\n");
+    const bool asyncStarted = sr::Logger::startAsync(64);
+    assert(asyncStarted && "asynchronous logging should start");
+    const bool asyncRestarted = sr::Logger::startAsync();
+    assert(!asyncRestarted && "asynchronous logging should start only once");
+    // workers one after another reuse ring buffer of the exited one
+    for (int i=1; i<=3; ++i)
+    {
+        std::thread asyncLogThread([i]() { LOGA("Log (asynchronous) from worker thread %d\n", i); });
+        asyncLogThread.join();
+    }
+    LOGA_GREEN("Log (asynchronous) - Green\n");
+    sr::Logger::stopAsync();
+    assert(!sr::Logger::isAsync() && sr::Logger::droppedRecords() == 0 && "all asynchronous records should be written");
 
     // MathUtil
     sr::MathUtil::init(10);
@@ -22,6 +117,17 @@ int main()
     std::cout << "MathUtil::randFloat(15.0f): " << sr::MathUtil::randFloat(15.0f) << std::endl;
     std::cout << "MathUtil::randFloat2(15.0f, 25.0f): " << sr::MathUtil::randFloat2(15.0f, 25.0f) << std::endl;
 
+    // Random
+    sr::Random random(42);
+    sr::Random randomSame(42);
+    assert(random.next() == randomSame.next() && "the same seed should produce the same sequence");
+    std::vector<int> randomInts(103);
+    random.fillInts(&randomInts[0], randomInts.size(), -3, 3);
+    assert(*std::min_element(randomInts.begin(), randomInts.end()) == -3 && *std::max_element(randomInts.begin(), randomInts.end()) == 3 && "filled integers should cover the whole range");
+    std::vector<float> randomFloats(103);
+    random.fillFloats(&randomFloats[0], randomFloats.size(), 2.0f, 4.0f);
+    assert(*std::min_element(randomFloats.begin(), randomFloats.end()) >= 2.0f && *std::max_element(randomFloats.begin(), randomFloats.end()) < 4.0f && "filled floating-point numbers should be in range");
+
     // Graphics Util
     const unsigned int redColor = sr::makeColorARGB(255, 255, 0, 0);
     const unsigned int redColorAlt = sr::makeColorARGB(255, 0, 0);
@@ -48,6 +154,21 @@ int main()
     float vec3fDot = sr::dot(vec3f, vec3f);
     assert(vec3fDot == (vec3f.x*vec3f.x + vec3f.y*vec3f.y + vec3f.z*vec3f.z) && "Wrong result of dot product");
 
+    // Vec3f_x4, Vec3f_x8
+    std::vector<sr::Vec3f> packetSrc;
+    for (int i=0; i<11; ++i)
+        packetSrc.push_back(sr::Vec3f(i + 1.0f, 0.0f, 0.0f));
+    sr::Vec3f_x8 packet8 = sr::loadVec3fPacket<sr::Float_x8>(packetSrc, 8);
+    packet8 = sr::cross(packet8, sr::Vec3f_x8::broadcast(sr::Vec3f(0.0f, 1.0f, 0.0f)));
+    packet8.normalize();
+    std::vector<sr::Vec3f> packetDst(11);
+    sr::storeVec3fPacket(packet8, packetDst, 8);
+    assert(std::abs(packetDst[10].z - 1.0f) < 1e-6f && packetDst[0].z == 0.0f && "cross product of x and y axis should be normalized z axis, vectors past the end should be skipped");
+    const sr::Vec3f_x4 packet4 = sr::loadVec3fPacket<sr::Float_x4>(packetSrc, 0);
+    float packetDots[4];
+    sr::dot(packet4, packet4).store(packetDots);
+    assert(packetDots[3] == 16.0f && "dot product of (4,0,0) with itself should be 16");
+
     // Color32i
     sr::Color32i colori = sr::Color32i(255, 0, 255, 255);
     std::cout << colori.packed << std::endl;
@@ -62,6 +183,393 @@ int main()
     assert(colorf.r == 1.0f && "red comonent value should be equal to 1.0f");
     assert(colorf.b == 1.0f && "blue component value should be equal to 1.0f");
 
+    // MemoryLayout
+    sr::TiledLayout<4> tiledLayout(16, 16);
+    assert(tiledLayout.index(4, 0) == 16 && "second tile should start right after the first tile");
+    assert(tiledLayout.index(1, 1) == 5 && "elements inside a tile should be row-major");
+    sr::MortonLayout mortonLayout(8, 4);
+    assert(mortonLayout.index(3, 3) == 15 && "Morton index of (3,3) should be 15");
+    assert(mortonLayout.index(4, 0) == 16 && "longer axis should be placed on top of interleaved bits");
+
+    // AlignedAllocator, both small and huge page mapped allocations are aligned to cache line
+    const size_t alignedSizes[] = { 24, 1000, sr::kHugePageSize, sr::kHugePageSize * 2 + 123 };
+    for (size_t bytes : alignedSizes)
+    {
+        unsigned char* aligned = static_cast<unsigned char*>(sr::alignedAlloc(bytes));
+        assert(aligned != nullptr && reinterpret_cast<size_t>(aligned) % 64 == 0 && "allocation should be aligned to cache line");
+        aligned[0] = 1;
+        aligned[bytes - 1] = 1;
+        sr::alignedFree(aligned, bytes);
+    }
+    sr::AlignedVector<sr::Color32f> alignedColors(37);
+    sr::AlignedVector<int> alignedInts(1001, 0);
+    alignedInts.resize(2003, 0);
+    assert(reinterpret_cast<size_t>(alignedColors.data()) % 64 == 0 && reinterpret_cast<size_t>(alignedInts.data()) % 64 == 0 && "elements should be aligned to cache line");
+    assert(std::all_of(alignedColors.begin(), alignedColors.end(), [](const sr::Color32f& c) { return c.r == 0.0f && c.a == 0.0f; }) && "elements should be constructed");
+    assert(std::count(alignedInts.begin(), alignedInts.end(), 0) == 2003 && "elements should be initialized with the value");
+    // first touch fills all elements when they don't split evenly into threads, nor into cache lines
+    const int firstTouchThreads[] = { 1, 3, 7, 64 };
+    for (int numThreads : firstTouchThreads)
+    {
+        std::fill(alignedInts.begin(), alignedInts.end(), -1);
+        sr::firstTouch(alignedInts.data(), 1001, 5, numThreads);
+        assert(std::count(alignedInts.begin(), alignedInts.begin() + 1001, 5) == 1001 && alignedInts[1001] == -1 && "first touch should fill exactly all elements");
+        sr::firstTouch(alignedColors.data(), alignedColors.size(), sr::Color32f(1.0f, 0.5f, 0.25f, 1.0f), numThreads);
+        assert(std::all_of(alignedColors.begin(), alignedColors.end(), [](const sr::Color32f& c) { return c.g == 0.5f; }) && "first touch should fill all elements");
+    }
+
+    // Parallel, each row is processed by exactly one band
+    std::vector<int> rowVisits(37, 0);
+    sr::parallelRows(37, 4, [&rowVisits](int rowBegin, int rowEnd) {
+        for (int y=rowBegin; y<rowEnd; ++y)
+            ++rowVisits[y];
+    });
+    assert(std::count(rowVisits.begin(), rowVisits.end(), 1) == 37 && "each row should be processed once");
+
+    // Blend
+    assert(sr::blend<sr::BlendMode::SRC_OVER>(0x80FF0000, 0xFF0000FF) == 0xFF80007F && "half translucent red over blue should be purple");
+    assert(sr::blend<sr::BlendMode::MULTIPLY>(0xFFFFFFFF, 0x12345678) == 0x12345678 && "multiplying by white should keep the color");
+
+    // HDRFrameBuffer, Reinhard tonemapping with and without gamma correction, the same for pixels resolved
+    // 4 at a time with SIMD and the remaining ones (width isn't multiple of 4)
+    const sr::Color32f hdrColors[4] = { sr::Color32f(0.0f, 1.0f, 3.0f, 1.0f), sr::Color32f(1e6f, 0.25f, -1.0f, 0.5f),
+                                        sr::Color32f(0.1f, 7.5f, 0.6f, 2.0f), sr::Color32f(2.25f, 0.0f, 12.0f, 0.0f) };
+    sr::HDRFrameBuffer hdr(7, 1);
+    for (int i=0; i<7; ++i)
+        hdr[i] = hdrColors[i % 4];
+    sr::FrameBuffer hdrFb(7, 1);
+    sr::resolveHDR(hdr, hdrFb, 1.0f, false, 1);
+    assert(hdrFb.get(0, 0) == 0xFF0080BF && hdrFb.get(1, 0) == 0x80FF3300 && "tonemapped 0, 1, 3 should be 0, 0.5, 0.75, values above 1 should approach 1");
+    assert(hdrFb.get(4, 0) == hdrFb.get(0, 0) && hdrFb.get(5, 0) == hdrFb.get(1, 0) && hdrFb.get(6, 0) == hdrFb.get(2, 0) && "SIMD and scalar resolve should be the same");
+    sr::resolveHDR(hdr, hdrFb, 1.0f, true, 1);
+    assert(hdrFb.get(0, 0) == 0xFF00B4DD && hdrFb.get(1, 0) == 0x80FF7200 && "gamma corrected 0.5, 0.75, 0.2 should be their square root");
+    assert(hdrFb.get(4, 0) == hdrFb.get(0, 0) && hdrFb.get(5, 0) == hdrFb.get(1, 0) && hdrFb.get(6, 0) == hdrFb.get(2, 0) && "SIMD and scalar resolve should be the same");
+
+    // GBuffer, octahedral normal round-trips within quantization error of 12 bits per axis on both hemispheres,
+    // and material ID is kept
+    std::vector<sr::Vec3f> gbufferNormals = { sr::Vec3f(1, 0, 0), sr::Vec3f(-1, 0, 0), sr::Vec3f(0, 1, 0), sr::Vec3f(0, -1, 0),
+                                              sr::Vec3f(0, 0, 1), sr::Vec3f(0, 0, -1), sr::Vec3f(1, 1, 0), sr::Vec3f(-1, 0, -1), sr::Vec3f(0, -1, -1) };
+    for (int i=0; i<8; ++i)
+        gbufferNormals.push_back(sr::Vec3f(i & 1 ? -1.0f : 1.0f, i & 2 ? -1.0f : 1.0f, i & 4 ? -1.0f : 1.0f));
+    float gbufferMaxError = 0.0f;
+    bool gbufferMaterialsKept = true;
+    for (size_t i=0; i<gbufferNormals.size(); ++i)
+    {
+        sr::Vec3f n = gbufferNormals[i];
+        n.normalize();
+        const unsigned int material = i == 0 ? 0xFE : static_cast<unsigned int>(i);
+        const unsigned int packed = sr::GBuffer::packSurface(n, material);
+        const sr::Vec3f error = sr::GBuffer::unpackNormal(packed) - n;
+        gbufferMaxError = std::max(gbufferMaxError, std::sqrt(error.squaredLength()));
+        gbufferMaterialsKept = gbufferMaterialsKept && sr::GBuffer::unpackMaterial(packed) == material;
+    }
+    assert(gbufferMaxError < 2e-3f && "unpacked normal should be within quantization error of the packed one");
+    assert(gbufferMaterialsKept && "material ID should be kept");
+    sr::GBuffer gbuffer(5, 3);
+    gbuffer.getSurface()[7] = sr::GBuffer::packSurface(sr::Vec3f(0, 0, 1), 1);
+    gbuffer.clear();
+    assert(std::all_of(gbuffer.getSurface(), gbuffer.getSurface() + 5*3, [](unsigned int s) { return sr::GBuffer::unpackMaterial(s) == sr::GBuffer::kNoMaterial; }) && "cleared pixel should have no material");
+
+    // OITBuffer, single translucent fragment resolves the same as blending it over
+    sr::OITBuffer oit(1, 1, 1.0f, -1.0f);
+    sr::FrameBuffer oitFb(1, 1, 0xFF0000FF);
+    oit.accumulate(0, sr::Color32f(1.0f, 0.0f, 0.0f, 0.5f), 0.0f);
+    sr::resolveOIT(oit, oitFb, 1);
+    assert(oitFb.get(0, 0) == 0xFF800080 && "half translucent red over blue should be purple");
+
+    // MSAABuffer, pixel on the edge of triangle is covered by half of its samples
+    sr::MSAABuffer msaa(8, 8);
+    sr::FrameBuffer msaaFb(8, 8);
+    float msaaDepths[3] = { 0.0f, 0.0f, 0.0f };
+    sr::triangle(sr::Vec2i(0, 0), sr::Vec2i(8, 0), sr::Vec2i(0, 8), msaaDepths, msaa, sr::Color32i(255, 255, 255));
+    sr::resolveMSAA(msaa, msaaFb, 1);
+    assert(msaaFb.get(1, 1) == 0xFFFFFFFF && "pixel inside triangle should be fully covered");
+    assert(msaaFb.get(4, 4) == 0x80808080 && "pixel on the edge should be half covered");
+    // sliver between pixel rows still covers samples
+    const sr::Vec4f sliverPositions[3] = { sr::Vec4f(0, 3.2f, 0, 1), sr::Vec4f(8, 3.2f, 0, 1), sr::Vec4f(8, 3.8f, 0, 1) };
+    ConstantShader sliverShader(sliverPositions);
+    msaa.clear(0x0);
+    sr::drawTrianglesMSAA(sliverShader, 1, msaa);
+    sr::resolveMSAA(msaa, msaaFb, 1);
+    assert(msaaFb.get(7, 4) != 0x0 && "sliver covering no pixel position should cover samples");
+
+    // FrameBuffer with tiled and Morton layout resolved back into row-major order
+    sr::FrameBufferT<sr::TiledLayout<8>> tiledFb(20, 12);
+    sr::FrameBufferT<sr::MortonLayout> mortonFb(20, 12);
+    for (int j=0; j<12; ++j)
+        for (int i=0; i<20; ++i)
+        {
+            tiledFb.set(i, j, i + j*20);
+            mortonFb.set(i, j, i + j*20);
+        }
+    std::vector<unsigned int> resolved(20 * 12);
+    tiledFb.resolve(&resolved[0]);
+    assert(resolved[19 + 11*20] == 19 + 11*20 && "tiled framebuffer should resolve into row-major order");
+    mortonFb.resolve(&resolved[0]);
+    assert(resolved[7 + 9*20] == 7 + 9*20 && "Morton framebuffer should resolve into row-major order");
+
+    // shader pipeline writes into framebuffer of any layout, the same pixels as of linear one
+    const sr::Vec4f trianglePositions[3] = { sr::Vec4f(1, 1, 0, 1), sr::Vec4f(19, 2, 0, 1), sr::Vec4f(4, 11, 0, 1) };
+    ConstantShader constantShader(trianglePositions);
+    sr::FrameBuffer linearTriangleFb(20, 12);
+    sr::FrameBufferT<sr::MortonLayout> mortonTriangleFb(20, 12);
+    std::vector<float> triangleDepths(20 * 12, -1.0f);
+    sr::drawTriangles(constantShader, 1, linearTriangleFb, &triangleDepths[0]);
+    std::fill(triangleDepths.begin(), triangleDepths.end(), -1.0f);
+    sr::drawTriangles(constantShader, 1, mortonTriangleFb, &triangleDepths[0]);
+    mortonTriangleFb.resolve(&resolved[0]);
+    assert(std::equal(resolved.begin(), resolved.end(), linearTriangleFb.getFrameBuffer()) && "triangle drawn into Morton framebuffer should resolve the same as linear one");
+
+    // TriangleSetup, triangles sharing edges through pixel positions (horizontal, vertical, diagonal) cover each pixel once
+    const sr::Vec4f fanRing[8] = { sr::Vec4f(-1, -1, 0, 1), sr::Vec4f(16, -1, 0, 1), sr::Vec4f(33, -1, 0, 1), sr::Vec4f(33, 16, 0, 1),
+                                   sr::Vec4f(33, 33, 0, 1), sr::Vec4f(16, 33, 0, 1), sr::Vec4f(-1, 33, 0, 1), sr::Vec4f(-1, 16, 0, 1) };
+    std::vector<sr::Vec4f> sharedEdgeTriangles;
+    for (int i=0; i<8; ++i)
+    {
+        sharedEdgeTriangles.push_back(sr::Vec4f(16, 16, 0, 1));
+        sharedEdgeTriangles.push_back(fanRing[i]);
+        sharedEdgeTriangles.push_back(fanRing[(i + 1) % 8]);
+    }
+    // quad split along diagonal, and two triangles sharing an edge not aligned to pixels
+    const sr::Vec4f sharedEdgeQuads[12] = { sr::Vec4f(-1, -1, 0, 1), sr::Vec4f(33, -1, 0, 1), sr::Vec4f(33, 33, 0, 1),
+                                            sr::Vec4f(-1, -1, 0, 1), sr::Vec4f(33, 33, 0, 1), sr::Vec4f(-1, 33, 0, 1),
+                                            sr::Vec4f(2.5f, 0.3f, 0, 1), sr::Vec4f(30.7f, 31.2f, 0, 1), sr::Vec4f(31.5f, 1.25f, 0, 1),
+                                            sr::Vec4f(2.5f, 0.3f, 0, 1), sr::Vec4f(30.7f, 31.2f, 0, 1), sr::Vec4f(1.75f, 29.5f, 0, 1) };
+    sharedEdgeTriangles.insert(sharedEdgeTriangles.end(), sharedEdgeQuads, sharedEdgeQuads + 12);
+    std::vector<float> coverageDepths(33 * 33, -std::numeric_limits<float>::max());
+    std::vector<int> coverage(33 * 33);
+    const int sharedEdgeGroups[][2] = { { 0, 8 }, { 8, 10 }, { 10, 12 } };
+    bool coveredOnce = true;
+    for (const int (&group)[2] : sharedEdgeGroups)
+    {
+        std::fill(coverage.begin(), coverage.end(), 0);
+        for (int i=group[0]; i<group[1]; ++i)
+        {
+            sr::TriangleSetup<0> coverageSetup;
+            if (!coverageSetup.setup(&sharedEdgeTriangles[i*3], nullptr, 33, 33))
+                continue;
+            sr::rasterizeTriangle<sr::DepthTest::GREATER, sr::DepthWrite::DISABLED>(coverageSetup, &coverageDepths[0], 33, [&coverage](int, int, int index, const sr::Varyings<0>&) -> bool {
+                ++coverage[index];
+                return true;
+            });
+        }
+        // fan and quad cover the whole viewport, the last pair covers only part of it
+        const int maxCoverage = *std::max_element(coverage.begin(), coverage.end());
+        const int minCoverage = *std::min_element(coverage.begin(), coverage.end());
+        coveredOnce = coveredOnce && maxCoverage == 1 && (group[0] == 10 || minCoverage == 1);
+    }
+    assert(coveredOnce && "pixel on edge shared by two triangles should be covered exactly once");
+    // perspective-correct interpolation at pixel position, attribute/w and 1/w are linear in screen space
+    const sr::Vec4f perspectivePositions[3] = { sr::Vec4f(2, 2, 0, 1.0f), sr::Vec4f(30, 4, 0, 4.0f), sr::Vec4f(8, 28, 0, 2.0f) };
+    sr::Varyings<1> perspectiveAttributes[3];
+    perspectiveAttributes[0][0] = 0.0f;
+    perspectiveAttributes[1][0] = 10.0f;
+    perspectiveAttributes[2][0] = 20.0f;
+    sr::TriangleSetup<1> perspectiveSetup;
+    const bool perspectiveSetUp = perspectiveSetup.setup(perspectivePositions, perspectiveAttributes, 33, 33);
+    assert(perspectiveSetUp && "triangle inside viewport should be set up");
+    float perspectiveValue = -1.0f;
+    std::fill(coverageDepths.begin(), coverageDepths.end(), -std::numeric_limits<float>::max());
+    sr::rasterizeTriangle<sr::DepthTest::GREATER, sr::DepthWrite::DISABLED>(perspectiveSetup, &coverageDepths[0], 33, [&perspectiveValue](int x, int y, int, const sr::Varyings<1>& v) -> bool {
+        if (x == 12 && y == 10)
+            perspectiveValue = v[0];
+        return true;
+    });
+    // screen space barycentric coordinate of pixel (12, 10), then attribute is weighted by it divided by w
+    double perspectiveBary[3];
+    for (int i=0; i<3; ++i)
+    {
+        const sr::Vec4f& v1 = perspectivePositions[(i + 1) % 3];
+        const sr::Vec4f& v2 = perspectivePositions[(i + 2) % 3];
+        perspectiveBary[i] = (v2.x - v1.x) * (10.0 - v1.y) - (v2.y - v1.y) * (12.0 - v1.x);
+    }
+    double weightedSum = 0.0;
+    double weightSum = 0.0;
+    for (int i=0; i<3; ++i)
+    {
+        weightedSum += perspectiveBary[i] * perspectiveAttributes[i][0] / perspectivePositions[i].w;
+        weightSum += perspectiveBary[i] / perspectivePositions[i].w;
+    }
+    assert(std::abs(perspectiveValue - weightedSum / weightSum) < 1e-3 && "attribute should be interpolated in perspective-correct manner");
+
+    // depth pre-pass then color pass with equal depth test shades the same pixels as of greater depth test,
+    // as both evaluate depth plane the same way
+    const int kNumDepthFaces = 6;
+    sr::Vec4f depthFacePositions[kNumDepthFaces * 3];
+    sr::Vec2i depthFaceVertices[kNumDepthFaces * 3];
+    sr::Random depthRandom(11);
+    for (int i=0; i<kNumDepthFaces*3; ++i)
+    {
+        depthFaceVertices[i] = sr::Vec2i(depthRandom.nextInt(-8, 72), depthRandom.nextInt(-8, 56));
+        depthFacePositions[i] = sr::Vec4f(depthFaceVertices[i].x, depthFaceVertices[i].y, depthRandom.nextFloat(-1.0f, 1.0f), 1.0f);
+    }
+    sr::FrameBuffer greaterFb(64, 48);
+    sr::FrameBuffer equalFb(64, 48);
+    std::vector<float> greaterDepths(64 * 48, -std::numeric_limits<float>::max());
+    std::vector<float> equalDepths(64 * 48, -std::numeric_limits<float>::max());
+    for (int i=0; i<kNumDepthFaces; ++i)
+    {
+        float faceDepths[3] = { depthFacePositions[i*3].z, depthFacePositions[i*3+1].z, depthFacePositions[i*3+2].z };
+        sr::triangle(depthFaceVertices[i*3], depthFaceVertices[i*3+1], depthFaceVertices[i*3+2], faceDepths, greaterFb, &greaterDepths[0], sr::Color32i(40 * (i + 1), 255 - 40 * i, 0));
+        sr::triangleDepth(depthFaceVertices[i*3], depthFaceVertices[i*3+1], depthFaceVertices[i*3+2], faceDepths, 64, 48, &equalDepths[0]);
+    }
+    for (int i=0; i<kNumDepthFaces; ++i)
+    {
+        float faceDepths[3] = { depthFacePositions[i*3].z, depthFacePositions[i*3+1].z, depthFacePositions[i*3+2].z };
+        sr::triangle(depthFaceVertices[i*3], depthFaceVertices[i*3+1], depthFaceVertices[i*3+2], faceDepths, equalFb, &equalDepths[0], sr::Color32i(40 * (i + 1), 255 - 40 * i, 0), sr::DepthTest::EQUAL);
+    }
+    assert(std::count(greaterFb.getFrameBuffer(), greaterFb.getFrameBuffer() + 64*48, 0x0) < 64*48/2 && "overlapping triangles should cover most of framebuffer");
+    assert(std::equal(greaterFb.getFrameBuffer(), greaterFb.getFrameBuffer() + 64*48, equalFb.getFrameBuffer()) && "color pass after depth pre-pass should be the same as of greater depth test");
+    // the same through shader pipeline
+    FaceColorShader faceColorShader(depthFacePositions);
+    std::fill_n(greaterFb.getFrameBuffer(), 64*48, 0x0);
+    std::fill_n(equalFb.getFrameBuffer(), 64*48, 0x0);
+    std::fill(greaterDepths.begin(), greaterDepths.end(), -std::numeric_limits<float>::max());
+    std::fill(equalDepths.begin(), equalDepths.end(), -std::numeric_limits<float>::max());
+    sr::drawTriangles(faceColorShader, kNumDepthFaces, greaterFb, &greaterDepths[0]);
+    sr::drawTrianglesDepth(faceColorShader, kNumDepthFaces, 64, 48, &equalDepths[0]);
+    sr::drawTriangles(faceColorShader, kNumDepthFaces, equalFb, &equalDepths[0], sr::CullMode::NONE, sr::DepthTest::EQUAL);
+    assert(std::equal(greaterFb.getFrameBuffer(), greaterFb.getFrameBuffer() + 64*48, equalFb.getFrameBuffer()) && "shader color pass after depth pre-pass should be the same as of greater depth test");
+
+    // Texture2D
+    std::vector<unsigned int> checker(8 * 8);
+    for (int j=0; j<8; ++j)
+        for (int i=0; i<8; ++i)
+            checker[i + j*8] = ((i + j) % 2 == 0) ? 0xFFFFFFFF : 0xFF000000;
+    sr::Texture2D<> texture;
+    texture.create(&checker[0], 8, 8);
+    assert(texture.getNumLevels() == 4 && "8x8 texture should have 4 mip levels");
+    assert(texture.sample(0.0f, 0.0f, sr::TextureFilter::NEAREST) == 0xFFFFFFFF && "texel at (0,0) should be white");
+    assert(texture.getLevel(3).fetch(0, 0) == 0xFF808080 && "last mip level should be averaged to gray");
+    std::cout << "Texture2D::sampleTrilinear(0.5f, 0.5f, 1.5f): " << std::hex << texture.sampleTrilinear(0.5f, 0.5f, 1.5f) << std::dec << std::endl;
+
+    // Graphics - line clipping and edge collection
+    sr::Vec2i clipStart(-100, 10);
+    sr::Vec2i clipEnd(300, 10);
+    const bool clipAccepted = sr::clipLine(clipStart, clipEnd, 256, 256);
+    assert(clipAccepted && "line crossing the viewport should be accepted");
+    assert(clipStart.x == 0 && clipEnd.x == 255 && "clipped line should end at the viewport border");
+    clipStart = sr::Vec2i(-10, -10);
+    clipEnd = sr::Vec2i(-1, 300);
+    const bool clipRejected = !sr::clipLine(clipStart, clipEnd, 256, 256);
+    assert(clipRejected && "line outside of the viewport should be rejected");
+    // lines crossing the border keep pixels of the whole line, and are clipped to their first and last pixel inside
+    sr::Random lineRandom(7);
+    sr::FrameBuffer lineFb(61, 47);
+    sr::FrameBuffer referenceLineFb(61, 47);
+    int clippedLineMismatches = 0;
+    for (int i=0; i<5000; ++i)
+    {
+        const sr::Vec2i a(lineRandom.nextInt(-100, 160), lineRandom.nextInt(-100, 146));
+        const sr::Vec2i b(lineRandom.nextInt(-100, 160), lineRandom.nextInt(-100, 146));
+        std::fill_n(lineFb.getFrameBuffer(), 61*47, 0x0);
+        std::fill_n(referenceLineFb.getFrameBuffer(), 61*47, 0x0);
+        sr::line(a, b, lineFb, sr::Color32i(255, 255, 255));
+        referenceLine(a, b, referenceLineFb, 0xFFFFFFFF);
+        clipStart = a;
+        clipEnd = b;
+        const bool clipped = sr::clipLine(clipStart, clipEnd, 61, 47);
+        const bool anyPixel = std::count(referenceLineFb.getFrameBuffer(), referenceLineFb.getFrameBuffer() + 61*47, 0xFFFFFFFF) > 0;
+        if (!std::equal(lineFb.getFrameBuffer(), lineFb.getFrameBuffer() + 61*47, referenceLineFb.getFrameBuffer()) || clipped != anyPixel ||
+            (clipped && (referenceLineFb.get(clipStart.x, clipStart.y) == 0x0 || referenceLineFb.get(clipEnd.x, clipEnd.y) == 0x0)))
+            ++clippedLineMismatches;
+    }
+    assert(clippedLineMismatches == 0 && "clipped lines should have the same pixels as of plotting every pixel with bounds check");
+    // lines of all octants, axis-aligned and single-point lines drawn by runs, whole and split into bands of single row
+    const int lineOffsets[][2] = { { 20, 7 }, { 7, 20 }, { -7, 20 }, { -20, 7 }, { -20, -7 }, { -7, -20 }, { 7, -20 }, { 20, -7 },
+                                   { 15, 15 }, { -15, 15 }, { 17, 0 }, { -17, 0 }, { 0, 19 }, { 0, -19 }, { 0, 0 }, { 23, 2 }, { 3, 22 } };
+    sr::FrameBuffer bandedLineFb(61, 47);
+    int octantLineMismatches = 0;
+    for (const int (&offset)[2] : lineOffsets)
+    {
+        for (int reversed=0; reversed<2; ++reversed)
+        {
+            const sr::Vec2i lineVertices[2] = { sr::Vec2i(30, 23), sr::Vec2i(30 + offset[0], 23 + offset[1]) };
+            const unsigned int lineIndices[2] = { static_cast<unsigned int>(reversed), static_cast<unsigned int>(1 - reversed) };
+            std::fill_n(lineFb.getFrameBuffer(), 61*47, 0x0);
+            std::fill_n(bandedLineFb.getFrameBuffer(), 61*47, 0x0);
+            std::fill_n(referenceLineFb.getFrameBuffer(), 61*47, 0x0);
+            sr::line(lineVertices[lineIndices[0]], lineVertices[lineIndices[1]], lineFb, sr::Color32i(255, 255, 255));
+            sr::linesParallel(lineVertices, lineIndices, 2, 2, bandedLineFb, sr::Color32i(255, 255, 255), 47);
+            referenceLine(lineVertices[lineIndices[0]], lineVertices[lineIndices[1]], referenceLineFb, 0xFFFFFFFF);
+            if (!std::equal(lineFb.getFrameBuffer(), lineFb.getFrameBuffer() + 61*47, referenceLineFb.getFrameBuffer()) ||
+                !std::equal(bandedLineFb.getFrameBuffer(), bandedLineFb.getFrameBuffer() + 61*47, referenceLineFb.getFrameBuffer()))
+                ++octantLineMismatches;
+        }
+    }
+    assert(octantLineMismatches == 0 && "lines drawn by runs should have the same pixels as of pixel-stepping Bresenham");
+    // anti-aliased line on pixel centers is fully covered, also on the last row and column where its pixel pair straddles the border
+    sr::FrameBuffer aaFb(32, 24);
+    sr::lineAA(sr::Vec2f(2.0f, 5.0f), sr::Vec2f(20.0f, 5.0f), aaFb, sr::Color32i(255, 255, 255));
+    sr::lineAA(sr::Vec2f(-5.0f, 23.0f), sr::Vec2f(40.0f, 23.0f), aaFb, sr::Color32i(255, 255, 255));
+    sr::lineAA(sr::Vec2f(31.0f, -3.0f), sr::Vec2f(31.0f, 30.0f), aaFb, sr::Color32i(255, 255, 255));
+    bool aaFullyCovered = true;
+    for (int x=3; x<20; ++x)
+        aaFullyCovered = aaFullyCovered && aaFb.get(x, 5) == 0xFFFFFFFF && aaFb.get(x, 4) == 0x0 && aaFb.get(x, 6) == 0x0;
+    for (int x=0; x<32; ++x)
+        aaFullyCovered = aaFullyCovered && aaFb.get(x, 23) == 0xFFFFFFFF;
+    for (int y=0; y<24; ++y)
+        aaFullyCovered = aaFullyCovered && aaFb.get(31, y) == 0xFFFFFFFF;
+    assert(aaFullyCovered && "anti-aliased line on pixel centers should cover full pixels only");
+    // line with end points outside blends the same coverage as the part of longer line inside larger framebuffer
+    const sr::Vec2f aaClippedLines[][2] = { { sr::Vec2f(-10.25f, -4.75f), sr::Vec2f(40.5f, 30.75f) }, { sr::Vec2f(35.5f, 3.25f), sr::Vec2f(-6.75f, 20.5f) },
+                                            { sr::Vec2f(12.25f, -9.5f), sr::Vec2f(20.75f, 33.25f) }, { sr::Vec2f(-3.5f, 23.25f), sr::Vec2f(34.75f, 22.5f) } };
+    sr::FrameBuffer aaLargeFb(32 + 32, 24 + 32);
+    int aaMaxDifference = 0;
+    for (const sr::Vec2f (&aaLine)[2] : aaClippedLines)
+    {
+        std::fill_n(aaFb.getFrameBuffer(), 32*24, 0x0);
+        std::fill_n(aaLargeFb.getFrameBuffer(), 64*56, 0x0);
+        sr::lineAA(aaLine[0], aaLine[1], aaFb, sr::Color32i(255, 255, 255));
+        sr::lineAA(sr::Vec2f(aaLine[0].x + 16.0f, aaLine[0].y + 16.0f), sr::Vec2f(aaLine[1].x + 16.0f, aaLine[1].y + 16.0f), aaLargeFb, sr::Color32i(255, 255, 255));
+        for (int y=0; y<24; ++y)
+            for (int x=0; x<32; ++x)
+                aaMaxDifference = std::max(aaMaxDifference, std::abs(static_cast<int>(aaFb.get(x, y) & 0xFF) - static_cast<int>(aaLargeFb.get(x + 16, y + 16) & 0xFF)));
+    }
+    assert(aaMaxDifference <= 2 && "clipped anti-aliased line should blend the same coverage as of unclipped one");
+
+    // lines drawn concurrently in bands are the same as drawn serially, for triangle edges crossing the border
+    std::vector<sr::Vec2i> edgeVertices;
+    for (int i=0; i<300; ++i)
+        edgeVertices.push_back(sr::Vec2i(lineRandom.nextInt(-40, 100), lineRandom.nextInt(-40, 86)));
+    std::vector<unsigned int> edgeIndices(3 * 400);
+    for (unsigned int& index : edgeIndices)
+        index = static_cast<unsigned int>(lineRandom.nextInt(0, 299));
+    std::fill_n(referenceLineFb.getFrameBuffer(), 61*47, 0x0);
+    sr::lines(&edgeVertices[0], &edgeIndices[0], static_cast<int>(edgeIndices.size()), 3, referenceLineFb, sr::Color32i(255, 255, 255));
+    const int lineThreadCounts[] = { 1, 2, 3, 5, 8, 47, 64 };
+    for (int numThreads : lineThreadCounts)
+    {
+        std::fill_n(lineFb.getFrameBuffer(), 61*47, 0x0);
+        sr::linesParallel(&edgeVertices[0], &edgeIndices[0], static_cast<int>(edgeIndices.size()), 3, lineFb, sr::Color32i(255, 255, 255), numThreads);
+        assert(std::equal(lineFb.getFrameBuffer(), lineFb.getFrameBuffer() + 61*47, referenceLineFb.getFrameBuffer()) && "lines drawn in parallel should be the same as drawn serially");
+    }
+    const unsigned int quadIndices[] = { 0, 1, 2, 2, 1, 3 };
+    assert(sr::uniqueEdges(quadIndices, 6, 3).size() == 5*2 && "shared edge of two triangles should be collected once");
+
+    // MeshGenerator
+    sr::MeshGeneratorParams meshParams;
+    meshParams.numTriangles = 100;
+    meshParams.sizeDistribution = sr::SizeDistribution::LOG_UNIFORM;
+    meshParams.numClusters = 4;
+    const sr::ObjData generatedMesh = sr::generateMesh(meshParams);
+    assert(generatedMesh.faces.size() == 100 && generatedMesh.vertices.size() == 300 && "mesh should have requested number of triangles");
+    assert(generatedMesh.vertices[299].x == sr::generateMesh(meshParams).vertices[299].x && "the same seed should generate the same mesh");
+    const sr::Vec3f& genV0 = generatedMesh.vertices[0];
+    assert(sr::cross(generatedMesh.vertices[1] - genV0, generatedMesh.vertices[2] - genV0).z > 0.0f && "generated triangle should face the viewer");
+
+    // ObjData face normals, FaceLighting
+    sr::ObjData litMesh;
+    litMesh.vertices = { sr::Vec3f(0.0f, 0.0f, 0.0f), sr::Vec3f(2.0f, 0.0f, 0.0f), sr::Vec3f(0.0f, 2.0f, 0.0f), sr::Vec3f(0.0f, 0.0f, 2.0f) };
+    litMesh.faces = { { 0, 1, 2 }, { 0, 2, 3 } };
+    litMesh.computeFaceNormals();
+    assert(litMesh.faceNormals.size() == 2 && std::abs(litMesh.faceNormals[0].z - 1.0f) < 1e-6f && std::abs(litMesh.faceNormals[1].x - 1.0f) < 1e-6f && "face normals should follow counter-clockwise winding");
+    std::vector<float> litIntensities;
+    std::vector<unsigned int> litColors;
+    sr::computeFaceIntensities(litMesh.faceNormals, sr::Vec3f(0.0f, 0.0f, -1.0f), litIntensities);
+    sr::computeFaceColors(litIntensities, sr::Color32i(255, 255, 255), litColors);
+    assert(litIntensities[0] == 0.0f && litColors[0] == 0xFF000000 && "face facing away from the light should be black");
+
     // TGAImage
     std::vector<unsigned int> frameBuffer;
     frameBuffer.resize(256 * 256);      // for 256 x 256 image
@@ -82,6 +590,24 @@ int main()
     sr::TGAImage::write24("out.tga", &frameBuffer[0], 256, 256);
     sr::Profile::endAndPrint();
 
+    // Profile zones, workers reusing buffer of the exited one are still reported as separate threads
+    for (int i=0; i<4; ++i)
+    {
+        std::thread worker([]() { SR_PROFILE_ZONE("test_worker"); });
+        worker.join();
+    }
+    std::vector<int> workerThreads;
+    for (const sr::ProfileZoneStats& z : sr::Profile::collectZones())
+    {
+        if (z.name == "test_worker")
+        {
+            assert(z.count == 1 && "each worker should record its own zone");
+            workerThreads.push_back(z.threadIndex);
+        }
+    }
+    std::sort(workerThreads.begin(), workerThreads.end());
+    assert(workerThreads.size() == 4 && std::unique(workerThreads.begin(), workerThreads.end()) == workerThreads.end() && "sequential workers should be reported as distinct threads");
+
     // ObjLoader
     std::cout << "Load dragon.obj\n";
     sr::Profile::start();
@@ -4,48 +4,12 @@
 #include "SR_Common.h"
 #include <cmath>
 #include <algorithm>
+#include <vector>
 
-/// Bresenham line drawing algorithm.
-/// This covers all cases (all octants).
-/// This function is grabbped from line/ program's line7() function.
-static void line_(sr::Vec2i start, sr::Vec2i end, sr::FrameBuffer& fb, unsigned int color)
-{
-    bool steep = false;
-    if (std::abs(start.x - end.x) < std::abs(start.y - end.y))          // choose range that has more width
-    {
-        std::swap(start.x, start.y);
-        std::swap(end.x, end.y);
-        steep = true;
-    }
-    if (start.x > end.x)
-    {
-        std::swap(start.x, end.x);
-        std::swap(start.y, end.y);
-    }
-    const int dx = end.x - start.x;
-    const int dy = end.y - start.y;
-    const int D = std::abs(2*dy);       // base difference constant on no changing of y, thus it's still at the same level
-    int error = 0;
-    const int errorIncrement = -2*dx;   // now dx is on the right side, and 2 is multiplied as initially we multiplied by 2 so the less should be the same
-
-    int y = start.y;
-    const int yStep = end.y > start.y ? 1 : -1;
-
-    for (int x = start.x; x <= end.x; ++x)
-    {
-        if (steep)
-            fb.set(y, x, color);
-        else
-            fb.set(x, y, color);
-
-        error += D;
-        if (error > dx)                 // dx switched to the left side of the equation thus it's now positive
-        {
-            y += yStep;
-            error += errorIncrement;
-        }
-    }
-}
+// define to 1 to draw anti-aliased lines instead of aliased Bresenham lines
+#define ANTI_ALIASED_LINES 0
+// define to 1 to draw aliased lines with all available threads, each one owns a horizontal band of framebuffer
+#define PARALLEL_LINES 1
 
 int main()
 {
@@ -60,30 +24,40 @@ int main()
 
     const std::vector<sr::Vec3f>& vertices = modelData.vertices;
     const std::vector<std::vector<unsigned int>>& faces = modelData.faces;
+    const int verticesCount = vertices.size();
     const int facesCount = faces.size();
     const float kScale = 0.13f;
 
-    sr::Profile::start();
+    // flatten faces into index buffer then collect edges once, shared edges would otherwise be drawn twice
+    std::vector<unsigned int> indices;
+    indices.reserve(facesCount * 3);
     for (int i=0; i<facesCount; ++i)
-    {
-        const std::vector<unsigned int>& fIndicesList = faces[i];
-
-        for (int j=0; j<3; ++j)
-        {
-            sr::Vec3f p1 = vertices[fIndicesList[j]];
-            sr::Vec3f p2 = vertices[fIndicesList[(j+1)%3]];
+        indices.insert(indices.end(), faces[i].begin(), faces[i].begin() + 3);
+    const std::vector<unsigned int> edges = sr::uniqueEdges(&indices[0], indices.size(), 3);
+    LOG("Unique edges: %zu (from %zu face edges)\n", edges.size() / 2, indices.size());
 
-            sr::Vec2i cvtP1 = sr::Vec2i(
-                    (p1.x * kScale + 1.0f) * fb.getWidth()*0.5f,
-                    (p1.y * kScale + 1.0f) * fb.getHeight()*0.5f - 300.0f);
-            sr::Vec2i cvtP2 = sr::Vec2i(
-                    (p2.x * kScale + 1.0f) * fb.getWidth()*0.5f,
-                    (p2.y * kScale + 1.0f) * fb.getHeight()*0.5f - 300.0f);
+#if ANTI_ALIASED_LINES
+    std::vector<sr::Vec2f> screenVertices(verticesCount);
+#else
+    std::vector<sr::Vec2i> screenVertices(verticesCount);
+#endif
 
-            line_(cvtP1, cvtP2, fb, 0xFFFFFFFF);
-            //sr::line(cvtP1, cvtP2, fb, 0xFFFFFFFF);       // the same line function is integrated into common/
-        }
+    sr::Profile::start();
+    // transform each vertex once
+    for (int i=0; i<verticesCount; ++i)
+    {
+        const sr::Vec3f& p = vertices[i];
+        screenVertices[i].x = (p.x * kScale + 1.0f) * fb.getWidth()*0.5f;
+        screenVertices[i].y = (p.y * kScale + 1.0f) * fb.getHeight()*0.5f - 300.0f;
     }
+#if ANTI_ALIASED_LINES
+    for (size_t i=0; i<edges.size(); i+=2)
+        sr::lineAA(screenVertices[edges[i]], screenVertices[edges[i+1]], fb, sr::Color32i(255, 255, 255));
+#elif PARALLEL_LINES
+    sr::linesParallel(&screenVertices[0], &edges[0], edges.size(), 2, fb, sr::Color32i(255, 255, 255));
+#else
+    sr::lines(&screenVertices[0], &edges[0], edges.size(), 2, fb, sr::Color32i(255, 255, 255));
+#endif
     sr::Profile::endAndPrint();
     sr::TGAImage::write24("out.tga", fb.getFrameBuffer(), fb.getWidth(), fb.getHeight());
     return 0;
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "Platform.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+SR_NAMESPACE_START
+
+///
+/// Aligned memory allocation for large buffers i.e. framebuffer, and depth buffer.
+///
+/// Memory is aligned to cache line so buffers split across threads don't share cache line at the boundary.
+/// On Linux, allocation as large as huge page or more is mapped directly, aligned to huge page and advised to be
+/// backed by transparent huge pages to reduce TLB misses. Such memory is not touched by allocation,
+/// thus its physical pages are placed on NUMA node of the thread first writing to it (see firstTouch()).
+
+/// Size of huge page on x86-64
+const size_t kHugePageSize = 2 * 1024 * 1024;
+
+///
+/// Allocate memory of at least `bytes` aligned to `alignment` bytes (power of two, and multiple of pointer size).
+/// Return nullptr if allocation failed. Free it with alignedFree() with the same size.
+inline void* alignedAlloc(size_t bytes, size_t alignment=SR_CACHE_LINE_SIZE)
+{
+#if defined(__linux__)
+    if (bytes >= kHugePageSize)
+    {
+        // over-allocate to align to huge page, then unmap the excess head and tail
+        const size_t size = (bytes + kHugePageSize - 1) & ~(kHugePageSize - 1);
+        void* mapped = mmap(nullptr, size + kHugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapped == MAP_FAILED)
+            return nullptr;
+
+        char* begin = static_cast<char*>(mapped);
+        char* aligned = reinterpret_cast<char*>((reinterpret_cast<size_t>(begin) + kHugePageSize - 1) & ~(kHugePageSize - 1));
+        if (aligned != begin)
+            munmap(begin, aligned - begin);
+        const size_t tail = (begin + size + kHugePageSize) - (aligned + size);
+        if (tail > 0)
+            munmap(aligned + size, tail);
+#if defined(MADV_HUGEPAGE)
+        // it's only a hint, allocation still works without huge pages
+        madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+        return aligned;
+    }
+#endif
+
+    void* p = nullptr;
+    if (posix_memalign(&p, alignment, bytes) != 0)
+        return nullptr;
+    return p;
+}
+
+///
+/// Free memory allocated by alignedAlloc().
+/// \param p Pointer returned by alignedAlloc()
+/// \param bytes Size as requested from alignedAlloc()
+inline void alignedFree(void* p, size_t bytes)
+{
+    if (p == nullptr)
+        return;
+
+#if defined(__linux__)
+    if (bytes >= kHugePageSize)
+    {
+        munmap(p, (bytes + kHugePageSize - 1) & ~(kHugePageSize - 1));
+        return;
+    }
+#else
+    (void)bytes;
+#endif
+    std::free(p);
+}
+
+///
+/// Allocator for standard containers using alignedAlloc().
+///
+/// Elements are default-initialized instead of value-initialized when constructed without argument,
+/// so `resize()` of container of plain type doesn't write into new memory. Such memory has to be
+/// initialized explicitly afterwards i.e. by firstTouch().
+template <typename T, size_t Alignment=SR_CACHE_LINE_SIZE>
+class AlignedAllocator
+{
+public:
+    typedef T value_type;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef AlignedAllocator<U, Alignment> other;
+    };
+
+    AlignedAllocator() {}
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(size_t n)
+    {
+        void* p = sr::alignedAlloc(n * sizeof(T), Alignment);
+        if (p == nullptr)
+            throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_t n)
+    {
+        sr::alignedFree(p, n * sizeof(T));
+    }
+
+    template <typename U>
+    void construct(U* p)
+    {
+        ::new(static_cast<void*>(p)) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args)
+    {
+        ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+///
+/// std::vector with cache line aligned storage
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+///
+/// Fill elements with the value from multiple threads, each one fills its contiguous chunk.
+/// Calling it on freshly allocated memory places each chunk's pages on NUMA node of the thread writing it,
+/// so it should be split the same way as threads processing the buffer later i.e. by horizontal bands of rows.
+/// \param data Elements to fill
+/// \param count Number of elements
+/// \param value Value to fill
+/// \param numThreads Number of threads, the calling thread fills the first chunk
+template <typename T>
+void firstTouch(T* data, size_t count, const T& value, int numThreads=std::thread::hardware_concurrency())
+{
+    numThreads = std::max(1, numThreads);
+    // keep chunks at cache line boundary, so no cache line is written by two threads
+    const size_t kElementsPerLine = std::max(static_cast<size_t>(1), SR_CACHE_LINE_SIZE / sizeof(T));
+    size_t chunk = (count + numThreads - 1) / numThreads;
+    chunk = (chunk + kElementsPerLine - 1) / kElementsPerLine * kElementsPerLine;
+
+    std::vector<std::thread> threads;
+    for (int i=1; i<numThreads && i*chunk < count; ++i)
+        threads.emplace_back([data, count, chunk, &value, i]() {
+            std::fill(data + i*chunk, data + std::min(count, (i+1)*chunk), value);
+        });
+    std::fill(data, data + std::min(count, chunk), value);
+    for (std::thread& t : threads)
+        t.join();
+}
+
+SR_NAMESPACE_END
@@ -0,0 +1,108 @@
+#include "Blend.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+SR_NAMESPACE_START
+
+#if defined(__SSE2__)
+///
+/// x * y / 255 with exact rounding for 16-bit lanes holding 8-bit values, same as mulComponent().
+static inline __m128i mulComponents(__m128i x, __m128i y)
+{
+    const __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, y), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+///
+/// Blend 2 pixels widened into 16-bit lanes.
+template <sr::BlendMode Mode>
+static inline __m128i blend2(__m128i s, __m128i d)
+{
+    const __m128i alphaOne = _mm_set_epi16(0xFF, 0, 0, 0, 0xFF, 0, 0, 0);
+    const __m128i alphaMask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    // broadcast alpha of each pixel to its 4 lanes
+    const __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128i invA = _mm_sub_epi16(_mm_set1_epi16(0xFF), a);
+    // source with alpha replaced by 1.0
+    const __m128i sc = _mm_or_si128(_mm_andnot_si128(alphaMask, s), alphaOne);
+
+    if (Mode == sr::BlendMode::SRC_OVER)
+        return _mm_add_epi16(mulComponents(sc, a), mulComponents(d, invA));
+    else if (Mode == sr::BlendMode::ADDITIVE)
+        return _mm_add_epi16(d, mulComponents(sc, a));
+    else if (Mode == sr::BlendMode::MULTIPLY)
+        return mulComponents(s, d);
+    else
+        return _mm_add_epi16(s, mulComponents(d, invA));
+}
+
+///
+/// Blend 4 pixels, results are saturated when narrowed back to 8-bit.
+template <sr::BlendMode Mode>
+static inline __m128i blend4(__m128i src, __m128i dst)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo = blend2<Mode>(_mm_unpacklo_epi8(src, zero), _mm_unpacklo_epi8(dst, zero));
+    const __m128i hi = blend2<Mode>(_mm_unpackhi_epi8(src, zero), _mm_unpackhi_epi8(dst, zero));
+    return _mm_packus_epi16(lo, hi);
+}
+#endif
+
+template <sr::BlendMode Mode>
+static void blendSpanImpl(const unsigned int* src, int srcStride, unsigned int* dst, int count)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i s = srcStride == 0 ? _mm_set1_epi32(*src) : _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i* d = reinterpret_cast<__m128i*>(dst + i);
+        _mm_storeu_si128(d, blend4<Mode>(s, _mm_loadu_si128(d)));
+    }
+#endif
+    for (; i<count; ++i)
+        dst[i] = sr::blend<Mode>(src[i * srcStride], dst[i]);
+}
+
+///
+/// Blend span with source pixels stepped by `srcStride`, 0 to blend single color.
+static void blendSpanStride(sr::BlendMode mode, const unsigned int* src, int srcStride, unsigned int* dst, int count)
+{
+    switch (mode)
+    {
+        case sr::BlendMode::REPLACE:
+            if (srcStride == 0)
+                std::fill_n(dst, count, *src);
+            else
+                std::copy(src, src + count, dst);
+            break;
+        case sr::BlendMode::SRC_OVER:
+            blendSpanImpl<sr::BlendMode::SRC_OVER>(src, srcStride, dst, count);
+            break;
+        case sr::BlendMode::ADDITIVE:
+            blendSpanImpl<sr::BlendMode::ADDITIVE>(src, srcStride, dst, count);
+            break;
+        case sr::BlendMode::MULTIPLY:
+            blendSpanImpl<sr::BlendMode::MULTIPLY>(src, srcStride, dst, count);
+            break;
+        case sr::BlendMode::PREMULTIPLIED:
+            blendSpanImpl<sr::BlendMode::PREMULTIPLIED>(src, srcStride, dst, count);
+            break;
+    }
+}
+
+void blendSpan(sr::BlendMode mode, const unsigned int* src, unsigned int* dst, int count)
+{
+    blendSpanStride(mode, src, 1, dst, count);
+}
+
+void blendSpan(sr::BlendMode mode, unsigned int color, unsigned int* dst, int count)
+{
+    blendSpanStride(mode, &color, 0, dst, count);
+}
+
+SR_NAMESPACE_END
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Platform.h"
+
+SR_NAMESPACE_START
+
+///
+/// Blend mode combining source color into destination color, both are packed 32-bit ARGB.
+/// Components are treated as normalized [0, 1] below, and results are saturated.
+enum class BlendMode
+{
+    REPLACE,            // out = src
+    SRC_OVER,           // out.rgb = src.rgb * src.a + dst.rgb * (1 - src.a), out.a = src.a + dst.a * (1 - src.a)
+    ADDITIVE,           // out.rgb = dst.rgb + src.rgb * src.a, out.a = dst.a + src.a
+    MULTIPLY,           // out = src * dst
+    PREMULTIPLIED       // out = src + dst * (1 - src.a), source color is already multiplied by its alpha
+};
+
+///
+/// Multiply two 8-bit components as normalized values, x * y / 255 with exact rounding.
+inline unsigned int mulComponent(unsigned int x, unsigned int y)
+{
+    const unsigned int t = x * y + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+///
+/// Blend single source pixel into destination pixel.
+template <sr::BlendMode Mode>
+inline unsigned int blend(unsigned int src, unsigned int dst)
+{
+    if (Mode == sr::BlendMode::REPLACE)
+        return src;
+
+    const unsigned int srcAlpha = src >> 24;
+    unsigned int out = 0;
+    for (int shift=0; shift<32; shift+=8)
+    {
+        const unsigned int s = (src >> shift) & 0xFF;
+        const unsigned int d = (dst >> shift) & 0xFF;
+        // alpha of source is applied to color components, but alpha itself is treated as color of 1.0
+        const unsigned int sc = shift == 24 ? 0xFF : s;
+        unsigned int c;
+        if (Mode == sr::BlendMode::SRC_OVER)
+            c = sr::mulComponent(sc, srcAlpha) + sr::mulComponent(d, 255 - srcAlpha);
+        else if (Mode == sr::BlendMode::ADDITIVE)
+            c = d + sr::mulComponent(sc, srcAlpha);
+        else if (Mode == sr::BlendMode::MULTIPLY)
+            c = sr::mulComponent(s, d);
+        else
+            c = s + sr::mulComponent(d, 255 - srcAlpha);
+        out |= (c > 0xFF ? 0xFF : c) << shift;
+    }
+    return out;
+}
+
+///
+/// Blend span of source pixels into destination pixels, multiple pixels are blended at once with SIMD.
+/// \param mode Blend mode
+/// \param src Source pixels
+/// \param dst Destination pixels
+/// \param count Number of pixels
+void blendSpan(sr::BlendMode mode, const unsigned int* src, unsigned int* dst, int count);
+
+///
+/// Blend single color into span of destination pixels, multiple pixels are blended at once with SIMD.
+/// \param mode Blend mode
+/// \param color Source color
+/// \param dst Destination pixels
+/// \param count Number of pixels
+void blendSpan(sr::BlendMode mode, unsigned int color, unsigned int* dst, int count);
+
+SR_NAMESPACE_END
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Platform.h"
+#include "AlignedAllocator.h"
+
+#include <limits>
+
+SR_NAMESPACE_START
+
+///
+/// Row-major buffer of depth values, greater value is closer to the viewer.
+/// It's used as z-buffer with width as line size by drawing functions i.e. sr::triangle(), or sr::drawTriangles().
+/// Storage is allocated aligned to cache line (and huge page for large buffer, see AlignedAllocator.h).
+class DepthBuffer
+{
+public:
+    ///
+    /// Create depth buffer cleared to the farthest depth.
+    /// \param width Width of depth buffer
+    /// \param height Height of depth buffer
+    /// \param numThreads Number of threads to clear (see firstTouch())
+    DepthBuffer(int width, int height, int numThreads=1)
+        : width(width)
+        , height(height)
+    {
+        depthBuffer.resize(width * height);
+        clear(farthest(), numThreads);
+    }
+
+    ///
+    /// Set all depth values to input depth.
+    void clear(float depth=farthest(), int numThreads=1)
+    {
+        sr::firstTouch(&depthBuffer[0], depthBuffer.size(), depth, numThreads);
+    }
+
+    ///
+    /// Return the farthest depth value.
+    static inline float farthest()
+    {
+        return -std::numeric_limits<float>::max();
+    }
+
+    inline float get(int x, int y) const
+    {
+        return depthBuffer[x + y*width];
+    }
+
+    inline float* getDepthBuffer()
+    {
+        return &depthBuffer[0];
+    }
+
+    inline const float* getDepthBuffer() const
+    {
+        return &depthBuffer[0];
+    }
+
+    inline float operator[](int i) const
+    {
+        return depthBuffer[i];
+    }
+
+    inline float& operator[](int i)
+    {
+        return depthBuffer[i];
+    }
+
+    inline int getWidth() const { return width; }
+    inline int getHeight() const { return height; }
+
+private:
+    int width;
+    int height;
+
+    sr::AlignedVector<float> depthBuffer;
+};
+
+SR_NAMESPACE_END
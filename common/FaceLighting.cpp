@@ -0,0 +1,65 @@
+#include "FaceLighting.h"
+#include "Vec3Packet.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+SR_NAMESPACE_START
+
+void computeFaceIntensities(const std::vector<sr::Vec3f>& faceNormals, const sr::Vec3f& lightDirection, std::vector<float>& outIntensities)
+{
+    const int kWidth = sr::Vec3f_x8::kWidth;
+    const size_t numFaces = faceNormals.size();
+    outIntensities.resize(numFaces);
+
+    const sr::Vec3f_x8 light = sr::Vec3f_x8::broadcast(lightDirection);
+    const sr::Float_x8 zero = sr::Float_x8::set1(0.0f);
+    for (size_t i=0; i<numFaces; i+=kWidth)
+    {
+        const sr::Float_x8 intensities = sr::max(sr::dot(sr::loadVec3fPacket<sr::Float_x8>(faceNormals, i), light), zero);
+        if (i + kWidth <= numFaces)
+        {
+            intensities.store(&outIntensities[i]);
+        }
+        else
+        {
+            float tail[kWidth];
+            intensities.store(tail);
+            std::copy(tail, tail + (numFaces - i), outIntensities.begin() + i);
+        }
+    }
+}
+
+void computeFaceColors(const std::vector<float>& faceIntensities, sr::Color32i color, std::vector<unsigned int>& outColors)
+{
+    const size_t numFaces = faceIntensities.size();
+    outColors.resize(numFaces);
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    // 4 faces at a time, components are truncated as converting float into Color32i
+    const __m128 r = _mm_set1_ps(color.r);
+    const __m128 g = _mm_set1_ps(color.g);
+    const __m128 b = _mm_set1_ps(color.b);
+    const __m128i alpha = _mm_set1_epi32(0xFF000000);
+    for (; i + 4 <= numFaces; i += 4)
+    {
+        const __m128 intensity = _mm_loadu_ps(&faceIntensities[i]);
+        const __m128i ri = _mm_slli_epi32(_mm_cvttps_epi32(_mm_mul_ps(intensity, r)), 16);
+        const __m128i gi = _mm_slli_epi32(_mm_cvttps_epi32(_mm_mul_ps(intensity, g)), 8);
+        const __m128i bi = _mm_cvttps_epi32(_mm_mul_ps(intensity, b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&outColors[i]), _mm_or_si128(_mm_or_si128(alpha, ri), _mm_or_si128(gi, bi)));
+    }
+#endif
+
+    for (; i<numFaces; ++i)
+    {
+        const float intensity = faceIntensities[i];
+        outColors[i] = sr::Color32i(intensity * color.r, intensity * color.g, intensity * color.b).packed;
+    }
+}
+
+SR_NAMESPACE_END
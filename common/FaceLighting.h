@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Platform.h"
+#include "Types.h"
+
+#include <vector>
+
+SR_NAMESPACE_START
+
+///
+/// Compute Lambert lighting intensity max(0, dot(normal, lightDirection)) of every face, 8 faces at a time
+/// in SoA form. For static geometry, face normals are computed once (see ObjData::computeFaceNormals()) so
+/// only this pass runs again when the light changes.
+///
+/// \param faceNormals Normalized face normals i.e. ObjData::faceNormals
+/// \param lightDirection Normalized direction towards the light
+/// \param outIntensities Output intensity of each face in [0, 1], resized to the number of faces
+void computeFaceIntensities(const std::vector<sr::Vec3f>& faceNormals, const sr::Vec3f& lightDirection, std::vector<float>& outIntensities);
+
+///
+/// Compute opaque packed ARGB color of every face as `color` scaled by its intensity, to be passed to
+/// rasterization as flat color.
+///
+/// \param faceIntensities Intensity of each face in [0, 1] as computed by computeFaceIntensities()
+/// \param color Color of fully lit face
+/// \param outColors Output color of each face, resized to the number of faces
+void computeFaceColors(const std::vector<float>& faceIntensities, sr::Color32i color, std::vector<unsigned int>& outColors);
+
+SR_NAMESPACE_END
@@ -1,23 +1,48 @@
 #pragma once
 
 #include "Platform.h"
+#include "MemoryLayout.h"
+#include "AlignedAllocator.h"
+#include "Blend.h"
 
 #include <vector>
+#include <cstring>
+#include <algorithm>
 
 SR_NAMESPACE_START
 
-class FrameBuffer
+///
+/// Framebuffer of 32-bit ARGB pixels stored with memory layout policy `Layout` (see MemoryLayout.h).
+///
+/// With LinearLayout, pixels are row-major and can be accessed directly via getFrameBuffer() with width as line size.
+/// With tiled or Morton layout, pixels close on screen are close in memory, so rasterizing a small block of
+/// pixels touches less cache lines. Index of pixel into getFrameBuffer() is given by getLayout().index(x, y), and
+/// resolve() converts pixels back into row-major order for output. Shader pipeline (see sr::drawTriangles()) writes
+/// into any layout, while line and fixed-color triangle functions in Graphics.h take row-major sr::FrameBuffer.
+///
+/// Pixels are allocated aligned to cache line (and huge page for large framebuffer, see AlignedAllocator.h).
+template <typename Layout>
+class FrameBufferT
 {
 public:
     typedef unsigned int type;
     typedef const unsigned int* const_pointer;
+    typedef Layout layout_type;
 
 public:
-    FrameBuffer(int width, int height)
+    ///
+    /// Create framebuffer cleared with the color.
+    /// \param width Width of framebuffer
+    /// \param height Height of framebuffer
+    /// \param clearColor Initial color of all pixels
+    /// \param numThreads Number of threads to clear (see firstTouch())
+    FrameBufferT(int width, int height, unsigned int clearColor=0x0, int numThreads=1)
         : width(width)
         , height(height)
+        , layout(width, height)
     {
-        frameBuffer.resize(width * height, 0x0);
+        frameBuffer.resize(layout.size());
+        sr::firstTouch(&frameBuffer[0], frameBuffer.size(), clearColor, numThreads);
     }
 
     ///
@@ -26,14 +51,25 @@ public:
     {
         if (x < 0 || x >= width || y < 0 || y >= height)
             return;
-        frameBuffer[x + y*width] = color;
+        frameBuffer[layout.index(x, y)] = color;
+    }
+
+    ///
+    /// Blend color into pixel at target position
+    template <sr::BlendMode Mode>
+    inline void blend(int x, int y, unsigned int color)
+    {
+        if (x < 0 || x >= width || y < 0 || y >= height)
+            return;
+        unsigned int& pixel = frameBuffer[layout.index(x, y)];
+        pixel = sr::blend<Mode>(color, pixel);
     }
 
     ///
     /// Get pixel value at target position
     inline unsigned int get(int x, int y) const
     {
-        return frameBuffer[x + y*width];
+        return frameBuffer[layout.index(x, y)];
     }
 
     inline unsigned int* getFrameBuffer()
@@ -46,6 +82,8 @@ public:
         return &frameBuffer[0];
     }
 
+    ///
+    /// Access pixel by its index in storage
     inline unsigned int operator[](int i) const
     {
         return frameBuffer[i];
@@ -56,15 +94,58 @@ public:
         return frameBuffer[i];
     }
 
+    inline const Layout& getLayout() const { return layout; }
     inline int getWidth() const { return width; }
     inline int getHeight() const { return height; }
 
+    ///
+    /// Copy pixels out in row-major order.
+    /// \param out Output pixels with at least width * height elements
+    void resolve(unsigned int* out) const
+    {
+        resolveLayout(layout, out);
+    }
+
+private:
+    inline void resolveLayout(const sr::LinearLayout&, unsigned int* out) const
+    {
+        std::memcpy(out, &frameBuffer[0], width * height * sizeof(type));
+    }
+
+    template <int TileSize>
+    inline void resolveLayout(const sr::TiledLayout<TileSize>&, unsigned int* out) const
+    {
+        // each row of a tile is contiguous
+        for (int y=0; y<height; ++y)
+        {
+            for (int x=0; x<width; x+=TileSize)
+            {
+                std::memcpy(out + x + y*width, &frameBuffer[layout.index(x, y)], std::min(TileSize, width - x) * sizeof(type));
+            }
+        }
+    }
+
+    template <typename OtherLayout>
+    inline void resolveLayout(const OtherLayout&, unsigned int* out) const
+    {
+        for (int y=0; y<height; ++y)
+        {
+            for (int x=0; x<width; ++x)
+                out[x + y*width] = frameBuffer[layout.index(x, y)];
+        }
+    }
+
 private:
     int width;
     int height;
+    Layout layout;
 
     // 32-bit pixel format ARGB
-    std::vector<unsigned int> frameBuffer;
+    sr::AlignedVector<unsigned int> frameBuffer;
 };
 
+///
+/// Framebuffer with row-major pixels
+typedef FrameBufferT<sr::LinearLayout> FrameBuffer;
+
 SR_NAMESPACE_END
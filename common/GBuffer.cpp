@@ -0,0 +1,78 @@
+#include "GBuffer.h"
+#include "GraphicsUtil.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+SR_NAMESPACE_START
+
+const unsigned int GBuffer::kNoMaterial;
+const unsigned int GBuffer::kNoSurface;
+
+///
+/// Shade rows [yBegin, yEnd) with Lambertian lighting.
+static void shadeLambertRows(const sr::GBuffer& gbuffer, const unsigned int materialAlbedos[], const sr::Vec3f& l, sr::FrameBuffer& fb, int yBegin, int yEnd)
+{
+    const int width = gbuffer.getWidth();
+    const unsigned int* surface = gbuffer.getSurface();
+    unsigned int* pixels = fb.getFrameBuffer();
+
+    const int begin = yBegin * width;
+    const int end = yEnd * width;
+    int i = begin;
+
+#if defined(__SSE2__)
+    // decode normals and compute intensity of 4 pixels at once
+    const __m128i mask12 = _mm_set1_epi32(0xFFF);
+    const __m128 scale = _mm_set1_ps(2.0f / 4095.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 lx = _mm_set1_ps(l.x);
+    const __m128 ly = _mm_set1_ps(l.y);
+    const __m128 lz = _mm_set1_ps(l.z);
+    SR_MEM_ALIGN(16) int intensities[4];
+
+    for (; i + 4 <= end; i += 4)
+    {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(surface + i));
+        __m128 x = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(s, mask12)), scale), one);
+        __m128 y = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(s, 12), mask12)), scale), one);
+        const __m128 z = _mm_sub_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, x)), _mm_andnot_ps(signMask, y));
+        // unfold lower hemisphere, t carries the sign of x or y
+        const __m128 t = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), z), _mm_setzero_ps());
+        x = _mm_sub_ps(x, _mm_or_ps(t, _mm_and_ps(signMask, x)));
+        y = _mm_sub_ps(y, _mm_or_ps(t, _mm_and_ps(signMask, y)));
+
+        const __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+        const __m128 ndotl = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, lx), _mm_mul_ps(y, ly)), _mm_mul_ps(z, lz));
+        const __m128 intensity = _mm_min_ps(_mm_max_ps(_mm_div_ps(ndotl, _mm_sqrt_ps(lengthSq)), _mm_setzero_ps()), one);
+        _mm_store_si128(reinterpret_cast<__m128i*>(intensities), _mm_cvtps_epi32(_mm_mul_ps(intensity, _mm_set1_ps(256.0f))));
+
+        for (int k=0; k<4; ++k)
+        {
+            const unsigned int material = sr::GBuffer::unpackMaterial(surface[i+k]);
+            if (material != sr::GBuffer::kNoMaterial)
+                pixels[i+k] = sr::lerpColorPacked(0xFF000000, materialAlbedos[material], intensities[k]);
+        }
+    }
+#endif
+
+    for (; i<end; ++i)
+    {
+        const unsigned int material = sr::GBuffer::unpackMaterial(surface[i]);
+        if (material == sr::GBuffer::kNoMaterial)
+            continue;
+        const float intensity = std::min(1.0f, std::max(0.0f, sr::dot(sr::GBuffer::unpackNormal(surface[i]), l)));
+        pixels[i] = sr::lerpColorPacked(0xFF000000, materialAlbedos[material], static_cast<unsigned int>(intensity * 256.0f + 0.5f));
+    }
+}
+
+void shadeLambert(const sr::GBuffer& gbuffer, const unsigned int materialAlbedos[], const sr::Vec3f& lightDirection, sr::FrameBuffer& fb, int numThreads)
+{
+    sr::parallelRows(gbuffer.getHeight(), numThreads, [&gbuffer, materialAlbedos, &lightDirection, &fb](int rowBegin, int rowEnd) {
+        shadeLambertRows(gbuffer, materialAlbedos, lightDirection, fb, rowBegin, rowEnd);
+    });
+}
+
+SR_NAMESPACE_END
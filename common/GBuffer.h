@@ -0,0 +1,192 @@
+#pragma once
+
+#include "Platform.h"
+#include "Types.h"
+#include "FrameBuffer.h"
+#include "Rasterizer.h"
+#include "Shader.h"
+#include "AlignedAllocator.h"
+#include "Parallel.h"
+
+#include <vector>
+#include <thread>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+SR_NAMESPACE_START
+
+///
+/// Geometry buffer holding visible surface of each pixel for deferred shading.
+///
+/// It has two planes stored separately (structure of arrays) so the shading pass streams through each one.
+/// Both are allocated aligned to cache line, so bands of rows shaded by different threads never share a cache line
+/// as long as width is multiple of 16.
+///  - depth, greater value is closer. It is used as z-buffer in visibility pass.
+///  - surface, packed 32-bit of octahedral-encoded normal (12 bits per axis) and 8-bit material ID
+///    at the highest byte. Material ID of kNoMaterial means nothing is rendered on such pixel.
+class GBuffer
+{
+public:
+    static const unsigned int kNoMaterial = 0xFF;
+    static const unsigned int kNoSurface = kNoMaterial << 24;
+
+public:
+    GBuffer(int width, int height)
+        : width(width)
+        , height(height)
+    {
+        depth.resize(width * height);
+        surface.resize(width * height);
+        clear();
+    }
+
+    ///
+    /// Reset depth to farthest, and surface to no material.
+    void clear()
+    {
+        std::fill(depth.begin(), depth.end(), -std::numeric_limits<float>::max());
+        std::fill(surface.begin(), surface.end(), kNoSurface);
+    }
+
+    ///
+    /// Pack unit normal vector and material ID into a single 32-bit value.
+    static inline unsigned int packSurface(const sr::Vec3f& n, unsigned int material)
+    {
+        // project onto octahedron, then fold lower hemisphere over the upper one
+        const float invL1 = 1.0f / (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+        float x = n.x * invL1;
+        float y = n.y * invL1;
+        if (n.z < 0.0f)
+        {
+            const float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            const float foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = foldedX;
+            y = foldedY;
+        }
+        const unsigned int ux = static_cast<unsigned int>((x * 0.5f + 0.5f) * 4095.0f + 0.5f);
+        const unsigned int uy = static_cast<unsigned int>((y * 0.5f + 0.5f) * 4095.0f + 0.5f);
+        return ux | (uy << 12) | (material << 24);
+    }
+
+    ///
+    /// Unpack normal vector (normalized) from packed surface value.
+    static inline sr::Vec3f unpackNormal(unsigned int packed)
+    {
+        float x = (packed & 0xFFF) * (2.0f / 4095.0f) - 1.0f;
+        float y = ((packed >> 12) & 0xFFF) * (2.0f / 4095.0f) - 1.0f;
+        const float z = 1.0f - std::abs(x) - std::abs(y);
+        const float t = std::max(-z, 0.0f);
+        x += x >= 0.0f ? -t : t;
+        y += y >= 0.0f ? -t : t;
+        sr::Vec3f n(x, y, z);
+        n.normalize();
+        return n;
+    }
+
+    ///
+    /// Unpack material ID from packed surface value.
+    static inline unsigned int unpackMaterial(unsigned int packed)
+    {
+        return packed >> 24;
+    }
+
+    inline float* getDepth() { return &depth[0]; }
+    inline const float* getDepth() const { return &depth[0]; }
+    inline unsigned int* getSurface() { return &surface[0]; }
+    inline const unsigned int* getSurface() const { return &surface[0]; }
+
+    inline int getWidth() const { return width; }
+    inline int getHeight() const { return height; }
+
+private:
+    int width;
+    int height;
+
+    sr::AlignedVector<float> depth;
+    sr::AlignedVector<unsigned int> surface;
+};
+
+///
+/// Visibility pass of deferred shading. Rasterize triangles with z-buffer testing into G-buffer.
+///
+/// Shader is the same as of drawTriangles() (see Shader.h) except that it implements
+/// `bool surface(int x, int y, const sr::Varyings<N>& varyings, sr::Vec3f& outNormal, unsigned int& outMaterial)`
+/// instead of `fragment()`. It should do as little work as possible as its result might be overwritten later.
+///
+/// \param shader Shader to process vertices and output surface of fragments
+/// \param numFaces Number of faces to draw
+/// \param gbuffer Target G-buffer
+/// \param cull Face culling mode
+template <typename ShaderT>
+void drawTrianglesGBuffer(ShaderT& shader, int numFaces, sr::GBuffer& gbuffer, sr::CullMode cull=sr::CullMode::NONE)
+{
+    const int kNumVaryings = ShaderT::kNumVaryings;
+    const int width = gbuffer.getWidth();
+    unsigned int* surface = gbuffer.getSurface();
+
+    sr::TriangleSetup<kNumVaryings> setup;
+    for (int i=0; i<numFaces; ++i)
+    {
+        if (!sr::setupFace(shader, i, width, gbuffer.getHeight(), cull, setup))
+            continue;
+
+        sr::rasterizeTriangle(setup, gbuffer.getDepth(), width, [&shader, surface](int x, int y, int index, const sr::Varyings<kNumVaryings>& varyings) -> bool {
+            sr::Vec3f normal;
+            unsigned int material;
+            if (!shader.surface(x, y, varyings, normal, material))
+                return false;
+            surface[index] = sr::GBuffer::packSurface(normal, material);
+            return true;
+        });
+    }
+}
+
+///
+/// Shading pass of deferred shading. Shade each pixel having surface in G-buffer exactly once, then
+/// output into framebuffer. Pixels without surface are left untouched.
+///
+/// Bands of rows are shaded concurrently with sr::parallelRows().
+/// `shade` is called as `unsigned int shade(int x, int y, float depth, const sr::Vec3f& normal, unsigned int material)`
+/// returning ARGB color. It must be safe to be called concurrently.
+///
+/// \param gbuffer Input G-buffer
+/// \param fb Output framebuffer, must have the same size as G-buffer
+/// \param shade Callable object to shade a pixel
+/// \param numThreads Number of threads shading bands of rows (see parallelRows())
+template <typename ShadeFunc>
+void deferredShade(const sr::GBuffer& gbuffer, sr::FrameBuffer& fb, ShadeFunc shade, int numThreads=std::thread::hardware_concurrency())
+{
+    const int width = gbuffer.getWidth();
+    auto shadeRows = [&gbuffer, &fb, &shade, width](int yBegin, int yEnd) {
+        const float* depth = gbuffer.getDepth();
+        const unsigned int* surface = gbuffer.getSurface();
+        unsigned int* pixels = fb.getFrameBuffer();
+        for (int y=yBegin; y<yEnd; ++y)
+        {
+            for (int index=y*width, x=0; x<width; ++x, ++index)
+            {
+                const unsigned int s = surface[index];
+                if (sr::GBuffer::unpackMaterial(s) == sr::GBuffer::kNoMaterial)
+                    continue;
+                pixels[index] = shade(x, y, depth[index], sr::GBuffer::unpackNormal(s), sr::GBuffer::unpackMaterial(s));
+            }
+        }
+    };
+
+    sr::parallelRows(gbuffer.getHeight(), numThreads, shadeRows);
+}
+
+///
+/// Shading pass of deferred shading with Lambertian diffuse lighting from a directional light.
+/// Output color is material's albedo modulated by lighting intensity. It processes multiple pixels at once
+/// with SIMD.
+///
+/// \param gbuffer Input G-buffer
+/// \param materialAlbedos Albedo color of each material ID in ARGB format
+/// \param lightDirection Normalized direction towards the light
+/// \param fb Output framebuffer, must have the same size as G-buffer
+/// \param numThreads Number of threads shading bands of rows (see parallelRows())
+void shadeLambert(const sr::GBuffer& gbuffer, const unsigned int materialAlbedos[], const sr::Vec3f& lightDirection, sr::FrameBuffer& fb, int numThreads=std::thread::hardware_concurrency());
+
+SR_NAMESPACE_END
@@ -1,5 +1,260 @@
 #include "Graphics.h"
 #include "MathUtil.h"
+#include "GraphicsUtil.h"
+#include "MemoryLayout.h"
+#include "Parallel.h"
+
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+///
+/// Write a run of pixels along the major axis of the line.
+/// Run of x-major line is contiguous in memory so it's filled as a span.
+template <bool Contiguous>
+static inline void lineRun(unsigned int* p, int length, int stride, unsigned int color)
+{
+    if (Contiguous)
+    {
+        std::fill_n(p, length, color);
+    }
+    else
+    {
+        for (int i=0; i<length; ++i, p+=stride)
+            *p = color;
+    }
+}
+
+///
+/// Minor offset m(n) of pixel n along major axis of Bresenham line, see lineRuns().
+static inline long long bresenhamMinorOffset(long long n, long long majorLength, long long minorLength)
+{
+    const long long e = n*2*minorLength - majorLength;
+    return e > 0 ? (e + 2*majorLength - 1) / (2*majorLength) : 0;
+}
+
+///
+/// Index of the first pixel of Bresenham line whose minor offset is at least k, from m(n) >= k.
+/// It's majorLength + 1 if there is no such pixel.
+static inline long long bresenhamFirstPixel(long long k, long long majorLength, long long minorLength)
+{
+    if (k <= 0)
+        return 0;
+    if (k > minorLength)
+        return majorLength + 1;
+    return (2*k - 1)*majorLength / (2*minorLength) + 1;
+}
+
+///
+/// Run-slice Bresenham, walk the line by runs of pixels having the same minor coordinate instead of pixel by pixel.
+/// Pixels are exactly the same as of pixel-stepping Bresenham.
+///
+/// Drawing can start in the middle of the line. Pixel-stepping Bresenham adds D = 2*minorLength to error per pixel,
+/// and steps minor axis once error > majorLength (then subtracts 2*majorLength), so error before pixel n always
+/// lies in (-majorLength, majorLength]. Thus the minor offset of pixel n is m(n) = ceil((n*D - majorLength) / (2*majorLength))
+/// and its error is n*D - m(n)*2*majorLength, and the state can be jumped to directly. So a clipped line is drawn
+/// from its first pixel inside the viewport with the same pixels as of drawing it whole.
+///
+/// \param pixels Pixels of framebuffer
+/// \param origin Index into `pixels` of the first pixel of the line, it can be outside of framebuffer
+/// \param first Index of the first pixel to draw along major axis
+/// \param count Number of pixels to draw
+/// \param majorLength Length of the line along major axis
+/// \param minorLength Length of the line along minor axis, not greater than majorLength
+/// \param majorStride Pointer increment to step along major axis
+/// \param minorStride Pointer increment to step along minor axis
+/// \param color Packed color for the line
+template <bool Contiguous>
+static void lineRuns(unsigned int* pixels, long long origin, int first, int count, int majorLength, int minorLength, int majorStride, int minorStride, unsigned int color)
+{
+    if (count <= 0)
+        return;
+
+    const int D = 2*minorLength;
+    if (D == 0)
+    {
+        lineRun<Contiguous>(pixels + (origin + static_cast<long long>(first)*majorStride), count, majorStride, color);
+        return;
+    }
+
+    const int twoMajor = 2*majorLength;
+    const long long minorOffset = bresenhamMinorOffset(first, majorLength, minorLength);
+    int error = static_cast<int>(static_cast<long long>(first)*D - minorOffset*twoMajor);
+    unsigned int* p = pixels + (origin + static_cast<long long>(first)*majorStride + minorOffset*minorStride);
+
+    // run length is the number of pixels until error exceeds majorLength.
+    // Every run after a minor step starts with error in (-majorLength, D - majorLength], so it's either q or q+1 pixels.
+    const int q = twoMajor / D;
+    int run = (majorLength - error) / D + 1;
+    for (;;)
+    {
+        run = std::min(run, count);
+        lineRun<Contiguous>(p, run, majorStride, color);
+        count -= run;
+        if (count == 0)
+            break;
+
+        p += run*majorStride + minorStride;
+        error += run*D - twoMajor;
+        run = error + q*D > majorLength ? q : q + 1;
+    }
+}
+
+///
+/// Bresenham line walked from its end point with smaller major coordinate, as pixels of the line depend
+/// on the direction it's drawn, and range of its pixels inside the viewport.
+struct LineSpan
+{
+    // first pixel of the whole line
+    sr::Vec2i origin;
+    int majorLength;
+    int minorLength;
+    // whether y is major axis
+    bool steep;
+    // +1 or -1 along minor axis
+    int minorStep;
+    // whether the line is walked from its ending position
+    bool reversed;
+    // range of pixels along major axis inside the viewport
+    int first;
+    int count;
+};
+
+///
+/// Clip Bresenham line against rectangle [0, width) x [rowBegin, rowEnd) in integer domain. Range of pixels
+/// along major axis is found from the range of each axis, so the clipped line keeps its error term.
+/// \return Return false if no pixel of the line is inside, otherwise return true.
+static bool clipLineSpan(const sr::Vec2i& start, const sr::Vec2i& end, int width, int rowBegin, int rowEnd, LineSpan& span)
+{
+    span.steep = std::abs(end.x - start.x) < std::abs(end.y - start.y);
+    long long major0 = span.steep ? start.y : start.x;
+    long long minor0 = span.steep ? start.x : start.y;
+    long long major1 = span.steep ? end.y : end.x;
+    long long minor1 = span.steep ? end.x : end.y;
+    span.reversed = major0 > major1;
+    if (span.reversed)
+    {
+        std::swap(major0, major1);
+        std::swap(minor0, minor1);
+    }
+    const long long majorLength = major1 - major0;
+    const long long minorLength = std::abs(minor1 - minor0);
+    span.minorStep = minor1 > minor0 ? 1 : -1;
+
+    const long long majorBegin = span.steep ? rowBegin : 0;
+    const long long majorEnd = span.steep ? rowEnd : width;
+    const long long minorBegin = span.steep ? 0 : rowBegin;
+    const long long minorEnd = span.steep ? width : rowEnd;
+
+    // range along major axis, then the range of minor offsets inside converted into range along major axis
+    long long nBegin = std::max(0LL, majorBegin - major0);
+    long long nEnd = std::min(majorLength + 1, majorEnd - major0);
+    const long long kBegin = span.minorStep > 0 ? minorBegin - minor0 : minor0 - minorEnd + 1;
+    const long long kEnd = span.minorStep > 0 ? minorEnd - minor0 : minor0 - minorBegin + 1;
+    nBegin = std::max(nBegin, bresenhamFirstPixel(kBegin, majorLength, minorLength));
+    nEnd = std::min(nEnd, bresenhamFirstPixel(kEnd, majorLength, minorLength));
+    if (nBegin >= nEnd)
+        return false;
+
+    span.origin.x = static_cast<int>(span.steep ? minor0 : major0);
+    span.origin.y = static_cast<int>(span.steep ? major0 : minor0);
+    span.majorLength = static_cast<int>(majorLength);
+    span.minorLength = static_cast<int>(minorLength);
+    span.first = static_cast<int>(nBegin);
+    span.count = static_cast<int>(nEnd - nBegin);
+    return true;
+}
+
+///
+/// Position of pixel n along major axis of the line.
+static inline sr::Vec2i linePixel(const LineSpan& span, int n)
+{
+    const int minor = static_cast<int>(span.minorStep * bresenhamMinorOffset(n, span.majorLength, span.minorLength));
+    return span.steep ? sr::Vec2i(span.origin.x + minor, span.origin.y + n) : sr::Vec2i(span.origin.x + n, span.origin.y + minor);
+}
+
+///
+/// Bresenham line rasterization, only pixels on columns [0, width) and rows [rowBegin, rowEnd) are drawn.
+/// Pixels are the same as of drawing the whole line pixel by pixel and skipping pixels outside, so the line
+/// can be split across row bands.
+/// \param start Screen space starting position of the line, it can be outside of framebuffer
+/// \param end Screen space ending position of the line, it can be outside of framebuffer
+/// \param pixels Pixels of framebuffer
+/// \param width Width of framebuffer, which is also its line size
+/// \param color Packed color for the line
+/// \param rowBegin First row to draw, not less than 0
+/// \param rowEnd One past the last row to draw, not greater than height of framebuffer
+static void lineClipped(const sr::Vec2i& start, const sr::Vec2i& end, unsigned int* pixels, int width, unsigned int color, int rowBegin, int rowEnd)
+{
+    LineSpan span;
+    if (!clipLineSpan(start, end, width, rowBegin, rowEnd, span))
+        return;
+
+    const long long origin = span.origin.x + static_cast<long long>(span.origin.y)*width;
+    // separate kernels for each major axis so nothing is branched per pixel
+    if (span.steep)
+        lineRuns<false>(pixels, origin, span.first, span.count, span.majorLength, span.minorLength, width, span.minorStep, color);
+    else
+        lineRuns<true>(pixels, origin, span.first, span.count, span.majorLength, span.minorLength, 1, span.minorStep*width, color);
+}
+
+///
+/// Liang-Barsky clipping of parametric line (x0 + t*dx, y0 + t*dy), t in [0, 1] against the rectangle.
+/// \return Return false if the line lies completely outside, otherwise return true with the clipped
+/// range of parameter in `t0` and `t1`.
+static bool clipParametric(double x0, double y0, double dx, double dy, double minX, double minY, double maxX, double maxY, double& t0, double& t1)
+{
+    const double p[4] = { -dx, dx, -dy, dy };
+    const double q[4] = { x0 - minX, maxX - x0, y0 - minY, maxY - y0 };
+
+    t0 = 0.0;
+    t1 = 1.0;
+    for (int i=0; i<4; ++i)
+    {
+        if (p[i] == 0.0)
+        {
+            // parallel to this boundary, and outside of it
+            if (q[i] < 0.0)
+                return false;
+            continue;
+        }
+
+        const double t = q[i] / p[i];
+        if (p[i] < 0.0)
+            t0 = std::max(t0, t);
+        else
+            t1 = std::min(t1, t);
+        if (t0 > t1)
+            return false;
+    }
+    return true;
+}
+
+///
+/// Clip line against the viewport in integer domain of Bresenham line.
+/// \param start Screen space starting position of the line, it will be updated to its first pixel inside the viewport
+/// \param end Screen space ending position of the line, it will be updated to its last pixel inside the viewport
+/// \param width Width of the viewport
+/// \param height Height of the viewport
+/// \return Return false if the line lies completely outside of the viewport, otherwise return true.
+bool sr::clipLine(sr::Vec2i& start, sr::Vec2i& end, int width, int height)
+{
+    LineSpan span;
+    if (!clipLineSpan(start, end, width, 0, height, span))
+        return false;
+
+    const sr::Vec2i first = linePixel(span, span.first);
+    const sr::Vec2i last = linePixel(span, span.first + span.count - 1);
+    const sr::Vec2i& newStart = span.reversed ? last : first;
+    const sr::Vec2i& newEnd = span.reversed ? first : last;
+    start.x = newStart.x;
+    start.y = newStart.y;
+    end.x = newEnd.x;
+    end.y = newEnd.y;
+    return true;
+}
 
 ///
 /// Line rasterization function
@@ -9,41 +264,292 @@
 /// \param color Color for the line
 void sr::line(sr::Vec2i start, sr::Vec2i end, sr::FrameBuffer& fb, sr::Color32i color)
 {
-    bool steep = false;
-    if (std::abs(start.x - end.x) < std::abs(start.y - end.y))          // choose range that has more width
+    // clip once up-front instead of checking bounds for every pixel
+    lineClipped(start, end, fb.getFrameBuffer(), fb.getWidth(), color.packed, 0, fb.getHeight());
+}
+
+///
+/// Blend the color over two pixels adjacent along minor axis of anti-aliased line.
+/// \param p0 First pixel
+/// \param p1 Second pixel
+/// \param color Packed color to blend, its alpha is treated as opaque as coverage already carries the alpha
+/// \param w0 Blend factor [0, 256] of the first pixel
+/// \param w1 Blend factor [0, 256] of the second pixel
+static inline void blendPixelPair(unsigned int* p0, unsigned int* p1, unsigned int color, int w0, int w1)
+{
+#if defined(__SSE2__)
+    // both pixels widen into 16-bit lanes of a single register, then src*w + dst*(256-w) never exceeds 16 bits
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i dst = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(*p0), _mm_cvtsi32_si128(*p1)), zero);
+    const __m128i src = _mm_unpacklo_epi8(_mm_set1_epi32(color), zero);
+    const __m128i w = _mm_set_epi16(w1, w1, w1, w1, w0, w0, w0, w0);
+    const __m128i invW = _mm_sub_epi16(_mm_set1_epi16(256), w);
+    const __m128i blended = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(src, w), _mm_mullo_epi16(dst, invW)), 8);
+    const __m128i packed = _mm_packus_epi16(blended, blended);
+    *p0 = _mm_cvtsi128_si32(packed);
+    *p1 = _mm_cvtsi128_si32(_mm_srli_si128(packed, 4));
+#else
+    *p0 = sr::lerpColorPacked(*p0, color, w0);
+    *p1 = sr::lerpColorPacked(*p1, color, w1);
+#endif
+}
+
+///
+/// Plot pixel pair of anti-aliased line at `major` position on major axis, and `minor`, `minor+1` on minor axis.
+/// Pixels outside of the framebuffer are skipped.
+template <bool Steep>
+static inline void plotAAPair(unsigned int* pixels, int pitch, int minorSize, int major, int minor, float coverage0, float coverage1, unsigned int color, float alphaScale)
+{
+    const int w0 = static_cast<int>(coverage0 * alphaScale + 0.5f);
+    const int w1 = static_cast<int>(coverage1 * alphaScale + 0.5f);
+    // position along minor axis is stepped to the next pixel row (or column for steep line)
+    const int minorStride = Steep ? 1 : pitch;
+    unsigned int* p = Steep ? pixels + minor + major*pitch : pixels + major + minor*pitch;
+
+    if (static_cast<unsigned int>(minor) < static_cast<unsigned int>(minorSize - 1))
     {
-        std::swap(start.x, start.y);
-        std::swap(end.x, end.y);
-        steep = true;
+        blendPixelPair(p, p + minorStride, color, w0, w1);
+        return;
     }
-    if (start.x > end.x)
+
+    // pair straddles the border
+    if (minor >= 0 && minor < minorSize)
+        *p = sr::lerpColorPacked(*p, color, w0);
+    if (minor + 1 >= 0 && minor + 1 < minorSize)
+        p[minorStride] = sr::lerpColorPacked(p[minorStride], color, w1);
+}
+
+static inline float fractionalPart(float x) { return x - std::floor(x); }
+
+///
+/// Xiaolin Wu's line with line already transformed to be along +x of major axis.
+/// End point cut by clipping continues past the viewport, so it's fully covered along major axis.
+template <bool Steep>
+static void lineAAMajor(float x0, float y0, float x1, float y1, bool clipped0, bool clipped1, unsigned int* pixels, int pitch, int minorSize, unsigned int color, float alphaScale)
+{
+    const float dx = x1 - x0;
+    const float gradient = dx == 0.0f ? 1.0f : (y1 - y0) / dx;
+
+    // end points, coverage along major axis is the fraction of pixel the line covers
+    const int majorStart = static_cast<int>(std::lround(x0));
+    const float yStart = y0 + gradient * (majorStart - x0);
+    const float gapStart = clipped0 ? 1.0f : 1.0f - fractionalPart(x0 + 0.5f);
+    const float fStart = fractionalPart(yStart);
+    plotAAPair<Steep>(pixels, pitch, minorSize, majorStart, static_cast<int>(std::floor(yStart)), (1.0f - fStart) * gapStart, fStart * gapStart, color, alphaScale);
+
+    const int majorEnd = static_cast<int>(std::lround(x1));
+    if (majorEnd == majorStart)
+        return;
+    const float yEnd = y1 + gradient * (majorEnd - x1);
+    const float gapEnd = clipped1 ? 1.0f : fractionalPart(x1 + 0.5f);
+    const float fEnd = fractionalPart(yEnd);
+    plotAAPair<Steep>(pixels, pitch, minorSize, majorEnd, static_cast<int>(std::floor(yEnd)), (1.0f - fEnd) * gapEnd, fEnd * gapEnd, color, alphaScale);
+
+    float y = yStart + gradient;
+    for (int x=majorStart+1; x<majorEnd; ++x, y+=gradient)
     {
-        std::swap(start.x, end.x);
-        std::swap(start.y, end.y);
+        const float f = fractionalPart(y);
+        plotAAPair<Steep>(pixels, pitch, minorSize, x, static_cast<int>(std::floor(y)), 1.0f - f, f, color, alphaScale);
     }
-    const int dx = end.x - start.x;
-    const int dy = end.y - start.y;
-    const int D = std::abs(2*dy);       // base difference constant on no changing of y, thus it's still at the same level
-    int error = 0;
-    const int errorIncrement = -2*dx;   // now dx is on the right side, and 2 is multiplied as initially we multiplied by 2 so the less should be the same
-    int y = start.y;
+}
 
-    const int yStep = end.y > start.y ? 1 : -1;
+///
+/// Anti-aliased line rasterization (Xiaolin Wu's algorithm).
+/// \param start Screen space starting position of the line
+/// \param end Screen space ending position of the line
+/// \param fb Color framebuffer
+/// \param color Color for the line
+void sr::lineAA(sr::Vec2f start, sr::Vec2f end, sr::FrameBuffer& fb, sr::Color32i color)
+{
+    const int width = fb.getWidth();
+    const int height = fb.getHeight();
+
+    // clip on pixel centers along major axis. Along minor axis, line within a pixel outside still covers
+    // the border pixel by the second pixel of its pair, then only the pixel pair can go outside.
+    double t0, t1;
+    const double dx = end.x - start.x;
+    const double dy = end.y - start.y;
+    const bool steep = std::abs(dy) > std::abs(dx);
+    if (!clipParametric(start.x, start.y, dx, dy, steep ? -1.0 : 0.0, steep ? 0.0 : -1.0,
+                        steep ? width : width - 1.0, steep ? height - 1.0 : height, t0, t1))
+        return;
+    float x0 = static_cast<float>(start.x + t0*dx);
+    float y0 = static_cast<float>(start.y + t0*dy);
+    float x1 = static_cast<float>(start.x + t1*dx);
+    float y1 = static_cast<float>(start.y + t1*dy);
+    bool clipped0 = t0 > 0.0;
+    bool clipped1 = t1 < 1.0;
 
-    for (int x = start.x; x <= end.x; ++x)
+    // coverage is scaled by alpha, then blended as opaque color (source-over)
+    const float alphaScale = color.a * (256.0f / 255.0f);
+    const unsigned int opaqueColor = color.packed | 0xFF000000;
+    unsigned int* pixels = fb.getFrameBuffer();
+
+    if (steep)
     {
-        if (steep)
-            fb.set(y, x, color.packed);
-        else
-            fb.set(x, y, color.packed);
+        if (y0 > y1)
+        {
+            std::swap(x0, x1);
+            std::swap(y0, y1);
+            std::swap(clipped0, clipped1);
+        }
+        lineAAMajor<true>(y0, x0, y1, x1, clipped0, clipped1, pixels, width, width, opaqueColor, alphaScale);
+    }
+    else
+    {
+        if (x0 > x1)
+        {
+            std::swap(x0, x1);
+            std::swap(y0, y1);
+            std::swap(clipped0, clipped1);
+        }
+        lineAAMajor<false>(x0, y0, x1, y1, clipped0, clipped1, pixels, width, height, opaqueColor, alphaScale);
+    }
+}
+
+///
+/// Collect unique edges from index buffer of primitives.
+/// \param indices Index buffer
+/// \param numIndices Number of indices
+/// \param indicesPerPrimitive Number of indices per primitive. 2 for line list, 3 for triangle list, etc.
+/// Each primitive is treated as closed polygon except line.
+/// \return Index buffer of line list in which each edge appears only once regardless of its direction.
+std::vector<unsigned int> sr::uniqueEdges(const unsigned int indices[], int numIndices, int indicesPerPrimitive)
+{
+    const int numPrimitives = numIndices / indicesPerPrimitive;
+    const int edgesPerPrimitive = indicesPerPrimitive == 2 ? 1 : indicesPerPrimitive;
+    const int maxEdges = numPrimitives * edgesPerPrimitive;
 
-        error += D; 
-        if (error > dx)                 // dx switched to the left side of the equation thus it's now positive
+    // open addressing hash set keyed by (smaller index, greater index), kept at most half full
+    const int kBits = sr::log2i(sr::nextPowerOfTwo(std::max(2*maxEdges, 2)));
+    const unsigned long long kEmpty = ~0ULL;
+    const size_t kMask = (static_cast<size_t>(1) << kBits) - 1;
+    std::vector<unsigned long long> table(kMask + 1, kEmpty);
+
+    std::vector<unsigned int> edges;
+    edges.reserve(maxEdges * 2);
+
+    for (int i=0; i<numPrimitives; ++i)
+    {
+        const unsigned int* primitive = indices + i*indicesPerPrimitive;
+        for (int j=0; j<edgesPerPrimitive; ++j)
         {
-            y += yStep;
-            error += errorIncrement;
+            const unsigned int a = primitive[j];
+            const unsigned int b = primitive[(j+1) % indicesPerPrimitive];
+            if (a == b)
+                continue;
+
+            const unsigned long long key = (static_cast<unsigned long long>(std::min(a, b)) << 32) | std::max(a, b);
+            // multiplicative hashing, take the highest bits
+            size_t slot = static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> (64 - kBits));
+            while (table[slot] != kEmpty && table[slot] != key)
+                slot = (slot + 1) & kMask;
+
+            if (table[slot] == kEmpty)
+            {
+                table[slot] = key;
+                edges.push_back(a);
+                edges.push_back(b);
+            }
         }
     }
+
+    return edges;
+}
+
+///
+/// Batched line rasterization from index buffer.
+/// Edges shared by primitives are drawn only once. Each line is clipped once up-front, then drawn
+/// without bounds checking per pixel.
+/// \param vertices Screen space positions
+/// \param indices Index buffer into `vertices`
+/// \param numIndices Number of indices
+/// \param indicesPerPrimitive Number of indices per primitive. 2 for line list, 3 for triangle list, etc.
+/// \param fb Color framebuffer
+/// \param color Color for all lines
+void sr::lines(const sr::Vec2i vertices[], const unsigned int indices[], int numIndices, int indicesPerPrimitive, sr::FrameBuffer& fb, sr::Color32i color)
+{
+    std::vector<unsigned int> edges;
+    if (indicesPerPrimitive != 2)
+    {
+        edges = sr::uniqueEdges(indices, numIndices, indicesPerPrimitive);
+        indices = edges.data();
+        numIndices = static_cast<int>(edges.size());
+    }
+
+    const int width = fb.getWidth();
+    const int height = fb.getHeight();
+    unsigned int* pixels = fb.getFrameBuffer();
+    for (int i=0; i+1<numIndices; i+=2)
+        lineClipped(vertices[indices[i]], vertices[indices[i+1]], pixels, width, color.packed, 0, height);
+}
+
+///
+/// Batched line rasterization from index buffer using multiple threads.
+///
+/// Framebuffer is split into horizontal bands, one per thread (see parallelRows()). Chunks of lines are clipped and
+/// binned into bands they cross concurrently (see parallelChunks()), then each thread draws only rows of its own band
+/// so no synchronization is needed while drawing.
+/// Result is exactly the same as of sr::lines().
+/// \param vertices Screen space positions
+/// \param indices Index buffer into `vertices`
+/// \param numIndices Number of indices
+/// \param indicesPerPrimitive Number of indices per primitive. 2 for line list, 3 for triangle list, etc.
+/// \param fb Color framebuffer
+/// \param color Color for all lines
+/// \param numThreads Number of threads to draw
+void sr::linesParallel(const sr::Vec2i vertices[], const unsigned int indices[], int numIndices, int indicesPerPrimitive, sr::FrameBuffer& fb, sr::Color32i color, int numThreads)
+{
+    std::vector<unsigned int> edges;
+    if (indicesPerPrimitive != 2)
+    {
+        edges = sr::uniqueEdges(indices, numIndices, indicesPerPrimitive);
+        indices = edges.data();
+        numIndices = static_cast<int>(edges.size());
+    }
+
+    const int width = fb.getWidth();
+    const int height = fb.getHeight();
+    const int numLines = numIndices / 2;
+    // bands are the ones sr::parallelRows() draws, and lines are binned by as many chunks of lines
+    const int numBands = std::max(1, std::min(numThreads, height));
+    const int bandHeight = sr::chunkSize(height, numThreads);
+    const int numChunks = std::max(1, std::min(numThreads, numLines));
+
+    struct Segment
+    {
+        sr::Vec2i start;
+        sr::Vec2i end;
+    };
+
+    // bins[c * numBands + b] holds segments of chunk c of lines crossing band b
+    std::vector<std::vector<Segment>> bins(numChunks * numBands);
+    sr::parallelChunks(numLines, numThreads, [&](int c, int lineBegin, int lineEnd) {
+        for (int i=lineBegin; i<lineEnd; ++i)
+        {
+            // clipped end points only choose bands, the whole line is drawn in each band to keep its pixels
+            const Segment segment = { vertices[indices[2*i]], vertices[indices[2*i+1]] };
+            sr::Vec2i start = segment.start;
+            sr::Vec2i end = segment.end;
+            if (!sr::clipLine(start, end, width, height))
+                continue;
+            const int bandBegin = std::min(start.y, end.y) / bandHeight;
+            const int bandEnd = std::max(start.y, end.y) / bandHeight;
+            for (int b=bandBegin; b<=bandEnd; ++b)
+                bins[c * numBands + b].push_back(segment);
+        }
+    });
+
+    unsigned int* pixels = fb.getFrameBuffer();
+    const unsigned int packed = color.packed;
+    sr::parallelRows(height, numThreads, [&](int rowBegin, int rowEnd) {
+        const int b = rowBegin / bandHeight;
+        for (int c=0; c<numChunks; ++c)
+        {
+            for (const Segment& segment : bins[c * numBands + b])
+                lineClipped(segment.start, segment.end, pixels, width, packed, rowBegin, rowEnd);
+        }
+    });
 }
 
 ///
@@ -80,6 +586,13 @@ void sr::triangle(sr::Vec2i t0, sr::Vec2i t1, sr::Vec2i t2, sr::FrameBuffer& fb,
     bbMax.y = std::min(maxH, std::max(bbMax.y, t1.y));
     bbMax.y = std::min(maxH, std::max(bbMax.y, t2.y));
 
+    SR_RASTER_STAT_ADD(trianglesSubmitted, 1);
+#if SR_RASTER_STATS == 1
+    // no depth test, so every pixel inside passes and is shaded
+    std::uint64_t shaded = 0;
+    sr::OverdrawMap* overdraw = sr::threadOverdrawMap();
+#endif
+
     sr::Vec2i p;
     for (p.x = bbMin.x; p.x<=bbMax.x; ++p.x)
     {
@@ -90,8 +603,32 @@ void sr::triangle(sr::Vec2i t0, sr::Vec2i t1, sr::Vec2i t2, sr::FrameBuffer& fb,
                 bcScreen.x > 1.0f || bcScreen.y > 1.0f || bcScreen.z > 1.0f)
                 continue;
             fb.set(p.x, p.y, color.packed);
+#if SR_RASTER_STATS == 1
+            ++shaded;
+            if (overdraw != nullptr)
+                overdraw->increment(p.x + p.y*fb.getWidth());
+#endif
         }
     } 
+
+#if SR_RASTER_STATS == 1
+    sr::RasterStats& stats = sr::threadRasterStats();
+    stats.pixelsTested += shaded;
+    stats.pixelsPassed += shaded;
+    stats.pixelsShaded += shaded;
+#endif
+}
+
+///
+/// Set up triangle from integer screen space positions and their depth values.
+static inline bool setupTriangle(const sr::Vec2i& t0, const sr::Vec2i& t1, const sr::Vec2i& t2, const float tDepths[3], int width, int height, sr::TriangleSetup<0>& setup, float sampleExtent=0.0f)
+{
+    const sr::Vec4f pos[3] = {
+        sr::Vec4f(t0.x, t0.y, tDepths[0], 1.0f),
+        sr::Vec4f(t1.x, t1.y, tDepths[1], 1.0f),
+        sr::Vec4f(t2.x, t2.y, tDepths[2], 1.0f)
+    };
+    return setup.setup(pos, nullptr, width, height, sampleExtent);
 }
 
 ///
@@ -102,52 +639,98 @@ void sr::triangle(sr::Vec2i t0, sr::Vec2i t1, sr::Vec2i t2, sr::FrameBuffer& fb,
 /// \param tDepths Array of float-point z-value (depth) for t0, t1, and t2 respectively.
 /// \param fb Color framebuffer
 /// \param color color for this triangle
-void sr::triangle(sr::Vec2i t0, sr::Vec2i t1, sr::Vec2i t2, float tDepths[3], sr::FrameBuffer& fb, float zBuffer[], sr::Color32i color)
+/// \param depthTest Depth test function. Use sr::DepthTest::EQUAL for color pass after depth pre-pass by sr::triangleDepth().
+void sr::triangle(sr::Vec2i t0, sr::Vec2i t1, sr::Vec2i t2, float tDepths[3], sr::FrameBuffer& fb, float zBuffer[], sr::Color32i color, sr::DepthTest depthTest)
 {
-    const int maxW = fb.getWidth() - 1;
-    const int maxH = fb.getHeight() - 1;
+    // depth is the only thing interpolated, and it is set up once for the whole triangle
+    sr::TriangleSetup<0> setup;
+    if (!setupTriangle(t0, t1, t2, tDepths, fb.getWidth(), fb.getHeight(), setup))
+        return;
 
-    // find the bounding box for the triangle
-    sr::Vec2i bbMin(maxW, maxH);
-    sr::Vec2i bbMax(0, 0);
+    unsigned int* pixels = fb.getFrameBuffer();
+    const unsigned int packed = color.packed;
+    auto writeColor = [pixels, packed](int, int, int index, const sr::Varyings<0>&) -> bool {
+        pixels[index] = packed;
+        return true;
+    };
 
-    // find minimum x/y
-    bbMin.x = std::max(0, std::min(bbMin.x, t0.x));
-    bbMin.x = std::max(0, std::min(bbMin.x, t1.x));
-    bbMin.x = std::max(0, std::min(bbMin.x, t2.x));
+    if (depthTest == sr::DepthTest::EQUAL)
+        sr::rasterizeTriangle<sr::DepthTest::EQUAL>(setup, zBuffer, fb.getWidth(), writeColor);
+    else
+        sr::rasterizeTriangle<sr::DepthTest::GREATER>(setup, zBuffer, fb.getWidth(), writeColor);
+}
 
-    bbMin.y = std::max(0, std::min(bbMin.y, t0.y));
-    bbMin.y = std::max(0, std::min(bbMin.y, t1.y));
-    bbMin.y = std::max(0, std::min(bbMin.y, t2.y));
+///
+/// Rasterizing of triangle routine with 4x multisample anti-aliasing.
+/// Depth is tested per sample against depth samples of `msaa`, and color is written into covered samples.
+/// Resolve `msaa` into framebuffer with sr::resolveMSAA() after all triangles are drawn.
+/// \param t0 Screen space first position of triangle
+/// \param t1 Screen space second position of triangle
+/// \param t2 Screen space third position of triangle
+/// \param tDepths Array of float-point z-value (depth) for t0, t1, and t2 respectively.
+/// \param msaa Multisample buffer
+/// \param color color for this triangle
+void sr::triangle(sr::Vec2i t0, sr::Vec2i t1, sr::Vec2i t2, float tDepths[3], sr::MSAABuffer& msaa, sr::Color32i color)
+{
+    sr::TriangleSetup<0> setup;
+    if (!setupTriangle(t0, t1, t2, tDepths, msaa.getWidth(), msaa.getHeight(), setup, sr::kMSAASampleExtent))
+        return;
 
-    // find maximum x/y
-    bbMax.x = std::min(maxW, std::max(bbMax.x, t0.x));
-    bbMax.x = std::min(maxW, std::max(bbMax.x, t1.x));
-    bbMax.x = std::min(maxW, std::max(bbMax.x, t2.x));
+    const unsigned int packed = color.packed;
+    sr::rasterizeTriangleMSAA(setup, msaa.getDepthSamples(), msaa.getWidth(), [&msaa, packed](int, int, int index, unsigned int coverage, const sr::Varyings<0>&) -> bool {
+        msaa.write(index, coverage, packed);
+        return true;
+    });
+}
 
-    bbMax.y = std::min(maxH, std::max(bbMax.y, t0.y));
-    bbMax.y = std::min(maxH, std::max(bbMax.y, t1.y));
-    bbMax.y = std::min(maxH, std::max(bbMax.y, t2.y));
+///
+/// Rasterizing of triangle routine into z-buffer only. This is for depth pre-pass.
+/// \param t0 Screen space first position of triangle
+/// \param t1 Screen space second position of triangle
+/// \param t2 Screen space third position of triangle
+/// \param tDepths Array of float-point z-value (depth) for t0, t1, and t2 respectively.
+/// \param width Width of z-buffer
+/// \param height Height of z-buffer
+/// \param zBuffer Depth buffer
+void sr::triangleDepth(sr::Vec2i t0, sr::Vec2i t1, sr::Vec2i t2, float tDepths[3], int width, int height, float zBuffer[])
+{
+    sr::TriangleSetup<0> setup;
+    if (!setupTriangle(t0, t1, t2, tDepths, width, height, setup))
+        return;
+    sr::rasterizeTriangleDepth(setup, zBuffer, width);
+}
 
-    sr::Vec2i p;
-    for (p.x = bbMin.x; p.x<=bbMax.x; ++p.x)
+///
+/// Rasterizing of triangle routine with z-buffer support, and perspective-correct interpolation of
+/// vertex colors.
+/// \param pos Screen space position of 3 vertices, z is depth (greater is closer), w is clip-space w
+/// \param colors Colors of 3 vertices respectively
+/// \param fb Color framebuffer
+/// \param zBuffer Depth buffer
+void sr::triangle(const sr::Vec4f pos[3], const sr::Color32f colors[3], sr::FrameBuffer& fb, float zBuffer[])
+{
+    sr::Varyings<4> attributes[3];
+    for (int i=0; i<3; ++i)
     {
-        for (p.y = bbMin.y; p.y<=bbMax.y; ++p.y)
-        {
-            sr::Vec3f bcScreen = sr::MathUtil::barycentric(t0, t1, t2, p);
-            if (bcScreen.x < 0.0f || bcScreen.y < 0.0f || bcScreen.z < 0.0f ||
-                bcScreen.x > 1.0f || bcScreen.y > 1.0f || bcScreen.z > 1.0f)
-                continue;
+        attributes[i][0] = colors[i].b;
+        attributes[i][1] = colors[i].g;
+        attributes[i][2] = colors[i].r;
+        attributes[i][3] = colors[i].a;
+    }
 
-            // compute z-depth value (note floating-point) for this particular pixel on this triangle
-            // surface
-            float z = bcScreen.x*tDepths[0] + bcScreen.y*tDepths[1] + bcScreen.z*tDepths[2];
-            // z-buffer testing
-            if (zBuffer[static_cast<int>(p.x + p.y*fb.getWidth())] < z)
-            {
-                zBuffer[static_cast<int>(p.x + p.y*fb.getWidth())] = z;
-                fb.set(p.x, p.y, color.packed);
-            }
+    sr::TriangleSetup<4> setup;
+    if (!setup.setup(pos, attributes, fb.getWidth(), fb.getHeight()))
+        return;
+
+    unsigned int* pixels = fb.getFrameBuffer();
+    sr::rasterizeTriangle(setup, zBuffer, fb.getWidth(), [pixels](int, int, int index, const sr::Varyings<4>& v) -> bool {
+        unsigned int packed = 0;
+        for (int i=0; i<4; ++i)
+        {
+            const float c = std::min(std::max(v[i], 0.0f), 1.0f);
+            packed |= static_cast<unsigned int>(c * 255.0f + 0.5f) << (i*8);
         }
-    } 
+        pixels[index] = packed;
+        return true;
+    });
 }
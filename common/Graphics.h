@@ -3,7 +3,11 @@
 #include "Platform.h"
 #include "Types.h"
 #include "FrameBuffer.h"
+#include "Rasterizer.h"
+#include "MSAABuffer.h"
 #include <algorithm>
+#include <vector>
+#include <thread>
 
 SR_NAMESPACE_START
 
@@ -11,12 +15,44 @@ SR_NAMESPACE_START
 /// Rasterization of line
 void line(sr::Vec2i start, sr::Vec2i end, sr::FrameBuffer& fb, sr::Color32i color);
 
+///
+/// Anti-aliased line rasterization, coverage of each pixel is blended over the framebuffer
+void lineAA(sr::Vec2f start, sr::Vec2f end, sr::FrameBuffer& fb, sr::Color32i color);
+
+///
+/// Batched rasterization of lines from index buffer, edges shared by primitives are drawn once
+void lines(const sr::Vec2i vertices[], const unsigned int indices[], int numIndices, int indicesPerPrimitive, sr::FrameBuffer& fb, sr::Color32i color);
+
+///
+/// Batched rasterization of lines split into horizontal bands drawn concurrently, edges shared by primitives are drawn once
+void linesParallel(const sr::Vec2i vertices[], const unsigned int indices[], int numIndices, int indicesPerPrimitive, sr::FrameBuffer& fb, sr::Color32i color, int numThreads=std::thread::hardware_concurrency());
+
+///
+/// Collect unique edges from index buffer of primitives, return index buffer of line list
+std::vector<unsigned int> uniqueEdges(const unsigned int indices[], int numIndices, int indicesPerPrimitive);
+
+///
+/// Clip line against the viewport to its first and last pixel inside, return false if it lies completely outside
+bool clipLine(sr::Vec2i& start, sr::Vec2i& end, int width, int height);
+
 ///
 /// Rasterization of triangle
 void triangle(sr::Vec2i t0, sr::Vec2i t1, sr::Vec2i t2, sr::FrameBuffer& fb, sr::Color32i color);
 
 ///
 /// Rasterization of triangle with z-buffer support
-void triangle(sr::Vec2i t0, sr::Vec2i t1, sr::Vec2i t2, float tDepths[3], sr::FrameBuffer& fb, float zBuffer[], sr::Color32i color);
+void triangle(sr::Vec2i t0, sr::Vec2i t1, sr::Vec2i t2, float tDepths[3], sr::FrameBuffer& fb, float zBuffer[], sr::Color32i color, sr::DepthTest depthTest=sr::DepthTest::GREATER);
+
+///
+/// Rasterization of triangle with 4x multisample anti-aliasing, coverage and depth are tested per sample
+void triangle(sr::Vec2i t0, sr::Vec2i t1, sr::Vec2i t2, float tDepths[3], sr::MSAABuffer& msaa, sr::Color32i color);
+
+///
+/// Rasterization of triangle into z-buffer only (depth pre-pass)
+void triangleDepth(sr::Vec2i t0, sr::Vec2i t1, sr::Vec2i t2, float tDepths[3], int width, int height, float zBuffer[]);
+
+///
+/// Rasterization of triangle with z-buffer support, and perspective-correct interpolation of vertex colors
+void triangle(const sr::Vec4f pos[3], const sr::Color32f colors[3], sr::FrameBuffer& fb, float zBuffer[]);
 
 SR_NAMESPACE_END
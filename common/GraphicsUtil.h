@@ -58,4 +58,16 @@ inline sr::Color32i makeColor32i(unsigned char r, unsigned char g, unsigned char
     return sr::Color32i(r, g, b);
 }
 
+///
+/// Linearly interpolate between two packed ARGB colors for all 4 components at once.
+/// `t` is fixed-point weight in range [0, 256] in which 0 returns `a`, and 256 returns `b`.
+inline unsigned int lerpColorPacked(unsigned int a, unsigned int b, unsigned int t)
+{
+    // operate on A/G and R/B pairs at once as each component has 8 spare bits to hold the product
+    const unsigned int invT = 256 - t;
+    const unsigned int rb = (((a & 0x00FF00FF) * invT + (b & 0x00FF00FF) * t) >> 8) & 0x00FF00FF;
+    const unsigned int ag = (((a >> 8) & 0x00FF00FF) * invT + ((b >> 8) & 0x00FF00FF) * t) & 0xFF00FF00;
+    return ag | rb;
+}
+
 SR_NAMESPACE_END
@@ -0,0 +1,88 @@
+#include "HDRFrameBuffer.h"
+#include "Parallel.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+SR_NAMESPACE_START
+
+///
+/// Tonemap single component into [0, 255].
+static inline unsigned int tonemapComponent(float c, float exposure, bool gammaCorrect)
+{
+    c = std::max(0.0f, c * exposure);
+    c = c / (1.0f + c);
+    if (gammaCorrect)
+        c = std::sqrt(c);
+    return static_cast<unsigned int>(c * 255.0f + 0.5f);
+}
+
+#if defined(__SSE2__)
+///
+/// Tonemap a pixel held as (b, g, r, a) into integer components in [0, 255].
+static inline __m128i tonemapPixel(__m128 c, __m128 exposure, __m128 alphaMask, bool gammaCorrect)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    // exposure is 1.0 for alpha, then alpha is only clamped
+    c = _mm_max_ps(_mm_mul_ps(c, exposure), zero);
+    __m128 mapped = _mm_div_ps(c, _mm_add_ps(one, c));
+    if (gammaCorrect)
+        mapped = _mm_sqrt_ps(mapped);
+    mapped = _mm_or_ps(_mm_andnot_ps(alphaMask, mapped), _mm_and_ps(alphaMask, _mm_min_ps(c, one)));
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(mapped, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+}
+#endif
+
+///
+/// Resolve pixels [begin, end).
+static void resolveHDRRange(const sr::Color32f* src, unsigned int* dst, int begin, int end, float exposure, bool gammaCorrect)
+{
+    int i = begin;
+
+#if defined(__SSE2__)
+    const __m128 exposureV = _mm_set_ps(1.0f, exposure, exposure, exposure);
+    const __m128 alphaMask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+    const float* p = reinterpret_cast<const float*>(src);
+
+    // 4 pixels at a time, components are narrowed down with saturation then stored as 4 packed ARGB pixels
+    for (; i + 4 <= end; i += 4)
+    {
+        const __m128i c0 = tonemapPixel(_mm_loadu_ps(p + i*4), exposureV, alphaMask, gammaCorrect);
+        const __m128i c1 = tonemapPixel(_mm_loadu_ps(p + i*4 + 4), exposureV, alphaMask, gammaCorrect);
+        const __m128i c2 = tonemapPixel(_mm_loadu_ps(p + i*4 + 8), exposureV, alphaMask, gammaCorrect);
+        const __m128i c3 = tonemapPixel(_mm_loadu_ps(p + i*4 + 12), exposureV, alphaMask, gammaCorrect);
+        const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(c0, c1), _mm_packs_epi32(c2, c3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+    }
+#endif
+
+    for (; i<end; ++i)
+    {
+        const sr::Color32f& c = src[i];
+        const unsigned int a = static_cast<unsigned int>(std::min(1.0f, std::max(0.0f, c.a)) * 255.0f + 0.5f);
+        dst[i] = (a << 24) |
+                 (tonemapComponent(c.r, exposure, gammaCorrect) << 16) |
+                 (tonemapComponent(c.g, exposure, gammaCorrect) << 8) |
+                 tonemapComponent(c.b, exposure, gammaCorrect);
+    }
+}
+
+void resolveHDR(const sr::HDRFrameBuffer& hdr, sr::FrameBuffer& fb, float exposure, bool gammaCorrect, int numThreads)
+{
+    const int width = hdr.getWidth();
+    const sr::Color32f* src = hdr.getFrameBuffer();
+    unsigned int* dst = fb.getFrameBuffer();
+
+    sr::parallelRows(hdr.getHeight(), numThreads, [src, dst, width, exposure, gammaCorrect](int rowBegin, int rowEnd) {
+        resolveHDRRange(src, dst, rowBegin * width, rowEnd * width, exposure, gammaCorrect);
+    });
+}
+
+SR_NAMESPACE_END
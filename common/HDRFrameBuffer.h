@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Platform.h"
+#include "Types.h"
+#include "FrameBuffer.h"
+#include "AlignedAllocator.h"
+
+#include <thread>
+
+SR_NAMESPACE_START
+
+///
+/// High dynamic range framebuffer of floating-point RGBA pixels (sr::Color32f).
+///
+/// Color is not clamped, so lighting can be accumulated beyond 1.0 with additive blending, then
+/// tonemapped only once into 8-bit ARGB framebuffer for output via resolveHDR().
+/// Pixels are row-major, and each one is 16 bytes in B, G, R, A order which is the same order as bytes of
+/// packed ARGB pixel in memory.
+class HDRFrameBuffer
+{
+public:
+    ///
+    /// Create framebuffer cleared with the color.
+    /// \param width Width of framebuffer
+    /// \param height Height of framebuffer
+    /// \param clearColor Initial color of all pixels
+    /// \param numThreads Number of threads to clear (see firstTouch())
+    HDRFrameBuffer(int width, int height, const sr::Color32f& clearColor=sr::Color32f(0.0f, 0.0f, 0.0f, 0.0f), int numThreads=1)
+        : width(width)
+        , height(height)
+    {
+        frameBuffer.resize(width * height);
+        clear(clearColor, numThreads);
+    }
+
+    ///
+    /// Set all pixels to the color.
+    void clear(const sr::Color32f& color, int numThreads=1)
+    {
+        sr::firstTouch(&frameBuffer[0], frameBuffer.size(), color, numThreads);
+    }
+
+    ///
+    /// Set pixel value at target position
+    inline void set(int x, int y, const sr::Color32f& color)
+    {
+        if (x < 0 || x >= width || y < 0 || y >= height)
+            return;
+        frameBuffer[x + y*width] = color;
+    }
+
+    ///
+    /// Add color to pixel at target position (additive blending)
+    inline void add(int x, int y, const sr::Color32f& color)
+    {
+        if (x < 0 || x >= width || y < 0 || y >= height)
+            return;
+        sr::Color32f& c = frameBuffer[x + y*width];
+        c.b += color.b;
+        c.g += color.g;
+        c.r += color.r;
+        c.a += color.a;
+    }
+
+    ///
+    /// Get pixel value at target position
+    inline const sr::Color32f& get(int x, int y) const
+    {
+        return frameBuffer[x + y*width];
+    }
+
+    inline sr::Color32f* getFrameBuffer()
+    {
+        return &frameBuffer[0];
+    }
+
+    inline const sr::Color32f* getFrameBuffer() const
+    {
+        return &frameBuffer[0];
+    }
+
+    inline const sr::Color32f& operator[](int i) const
+    {
+        return frameBuffer[i];
+    }
+
+    inline sr::Color32f& operator[](int i)
+    {
+        return frameBuffer[i];
+    }
+
+    inline int getWidth() const { return width; }
+    inline int getHeight() const { return height; }
+
+private:
+    int width;
+    int height;
+
+    sr::AlignedVector<sr::Color32f> frameBuffer;
+};
+
+///
+/// Resolve HDR framebuffer into 8-bit ARGB framebuffer.
+///
+/// RGB is scaled by exposure then tonemapped with Reinhard operator c / (1 + c), and optionally gamma corrected
+/// with gamma of 2.0 (square root) which is cheap to compute. Alpha is clamped to [0, 1].
+/// Multiple pixels are converted at once with SIMD.
+///
+/// \param hdr Input HDR framebuffer
+/// \param fb Output framebuffer, must have the same size as HDR framebuffer
+/// \param exposure Scale applied to RGB before tonemapping
+/// \param gammaCorrect Whether to apply gamma correction
+/// \param numThreads Number of threads resolving bands of rows (see parallelRows())
+void resolveHDR(const sr::HDRFrameBuffer& hdr, sr::FrameBuffer& fb, float exposure=1.0f, bool gammaCorrect=true, int numThreads=std::thread::hardware_concurrency());
+
+SR_NAMESPACE_END
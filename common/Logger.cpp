@@ -1,9 +1,239 @@
 #include "Logger.h"
 
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
 SR_NAMESPACE_START
 
 std::atomic_flag Logger::lock = ATOMIC_FLAG_INIT;
+std::atomic<bool> Logger::asyncEnabled(false);
 char Logger::fmtBuffer[MAX_BUFFER_SIZE];
 
-SR_NAMESPACE_END
+///
+/// Formatted record waiting to be written by drain thread
+struct AsyncLogRecord
+{
+    std::FILE* fs;
+    int length;
+    char text[Logger::ASYNC_RECORD_SIZE];
+};
+
+///
+/// Single-producer single-consumer ring buffer of a logging thread, the drain thread is the consumer.
+/// Positions only increase, slot is position masked by capacity.
+struct AsyncLogRing
+{
+    std::vector<AsyncLogRecord> records;
+    std::uint64_t mask;
+    // next position to push, written by producer
+    std::atomic<std::uint64_t> head;
+    // next position to drain, written by consumer
+    std::atomic<std::uint64_t> tail;
+    std::atomic<std::uint64_t> dropped;
+
+    explicit AsyncLogRing(int capacity)
+        : records(capacity)
+        , mask(capacity - 1)
+        , head(0)
+        , tail(0)
+        , dropped(0)
+    {
+    }
+};
+
+///
+/// Ring buffers of all threads which ever logged asynchronously, in order of registration, and ring buffers
+/// of exited threads ready to be reused
+static std::mutex gLogger_ringsMutex;
+static std::vector<std::unique_ptr<AsyncLogRing>> gLogger_rings;
+static std::vector<AsyncLogRing*> gLogger_freeRings;
+static int gLogger_ringCapacity = 1024;
+
+static std::atomic<bool> gLogger_drainRunning(false);
+static std::thread gLogger_drainThread;
+
+///
+/// Ring buffer held by a thread while it's alive. Once the thread exits, the ring buffer is released to be
+/// reused by the next thread logging asynchronously, records still queued in it are written before new ones.
+struct AsyncLogRingSlot
+{
+    AsyncLogRing* ring;
+
+    AsyncLogRingSlot()
+        : ring(nullptr)
+    {
+    }
+
+    ~AsyncLogRingSlot()
+    {
+        if (ring == nullptr)
+            return;
+        std::lock_guard<std::mutex> guard(gLogger_ringsMutex);
+        gLogger_freeRings.push_back(ring);
+    }
+};
+
+///
+/// Return ring buffer of the calling thread, acquired on first call. Ring buffers are never freed, so memory
+/// is bounded by the number of threads logging asynchronously at once.
+static AsyncLogRing* threadRing()
+{
+    static thread_local AsyncLogRingSlot slot;
+    if (slot.ring == nullptr)
+    {
+        std::lock_guard<std::mutex> guard(gLogger_ringsMutex);
+        if (!gLogger_freeRings.empty())
+        {
+            slot.ring = gLogger_freeRings.back();
+            gLogger_freeRings.pop_back();
+        }
+        else
+        {
+            gLogger_rings.emplace_back(new AsyncLogRing(gLogger_ringCapacity));
+            slot.ring = gLogger_rings.back().get();
+        }
+    }
+    return slot.ring;
+}
+
+///
+/// Write all queued records of all threads, return true if any is written.
+/// Ring buffers are listed into `rings` under the lock, then written without holding it so a thread
+/// acquiring its ring buffer doesn't wait for I/O.
+static bool drainRings(std::vector<AsyncLogRing*>& rings)
+{
+    {
+        std::lock_guard<std::mutex> guard(gLogger_ringsMutex);
+        rings.clear();
+        for (const std::unique_ptr<AsyncLogRing>& ring : gLogger_rings)
+            rings.push_back(ring.get());
+    }
+
+    bool written = false;
+    for (AsyncLogRing* ring : rings)
+    {
+        std::uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        const std::uint64_t head = ring->head.load(std::memory_order_acquire);
+        for (; tail != head; ++tail)
+        {
+            const AsyncLogRecord& record = ring->records[tail & ring->mask];
+            std::fwrite(record.text, 1, record.length, record.fs);
+            written = true;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+
+    if (written)
+    {
+        std::fflush(stdout);
+        std::fflush(stderr);
+    }
+    return written;
+}
+
+///
+/// Drain thread, it polls ring buffers and sleeps briefly when there's nothing to write.
+static void drainLoop()
+{
+    std::vector<AsyncLogRing*> rings;
+    while (gLogger_drainRunning.load(std::memory_order_acquire))
+    {
+        if (!drainRings(rings))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    drainRings(rings);
+}
 
+bool Logger::makeColorFormat(char* buffer, int bufferSize, TextColor tc, const char* fmt)
+{
+    int fg = 37;
+
+    switch (tc)
+    {
+    case TextColor::WHITE: fg = 37; break;
+    case TextColor::RED: fg = 31; break;
+    case TextColor::GREEN: fg = 32; break;
+    case TextColor::BLUE: fg = 34; break;
+    case TextColor::MAGENTA: fg = 35; break;
+    case TextColor::CYAN: fg = 36; break;
+    case TextColor::YELLOW: fg = 33; break;
+    }
+
+    // modify fmt string
+    const int bwritten = std::snprintf(buffer, bufferSize, "\033[1;%dm", fg);
+    const int fmtLength = static_cast<int>(std::strlen(fmt));
+    if (bwritten < 0 || fmtLength == 0 || bwritten + fmtLength - 1 + 5 >= bufferSize)
+        return false;
+    // copy original fmt not included \n
+    std::memcpy(buffer + bwritten, fmt, fmtLength - 1);
+    std::snprintf(buffer + bwritten + fmtLength - 1, bufferSize - (bwritten + fmtLength - 1), "\033[0m\n");
+    return true;
+}
+
+bool Logger::pushAsync(std::FILE* fs, const char* record, int length)
+{
+    if (length < 0)
+        return false;
+
+    AsyncLogRing* ring = threadRing();
+    const std::uint64_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) > ring->mask)
+    {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    AsyncLogRecord& slot = ring->records[head & ring->mask];
+    slot.fs = fs;
+    slot.length = std::min(length, ASYNC_RECORD_SIZE - 1);
+    std::memcpy(slot.text, record, slot.length);
+    ring->head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+bool Logger::startAsync(int recordsPerThread)
+{
+    if (gLogger_drainRunning.load())
+        return false;
+
+    {
+        std::lock_guard<std::mutex> guard(gLogger_ringsMutex);
+        gLogger_ringCapacity = 1;
+        while (gLogger_ringCapacity < recordsPerThread)
+            gLogger_ringCapacity <<= 1;
+    }
+
+    gLogger_drainRunning.store(true);
+    gLogger_drainThread = std::thread(drainLoop);
+    asyncEnabled.store(true);
+    return true;
+}
+
+void Logger::stopAsync()
+{
+    if (!gLogger_drainRunning.load())
+        return;
+
+    asyncEnabled.store(false);
+    gLogger_drainRunning.store(false);
+    gLogger_drainThread.join();
+
+    const std::uint64_t dropped = droppedRecords();
+    if (dropped > 0)
+        LogFS(stderr, "Logger dropped %lu records, increase records per thread of startAsync()\n", static_cast<unsigned long>(dropped));
+}
+
+std::uint64_t Logger::droppedRecords()
+{
+    std::lock_guard<std::mutex> guard(gLogger_ringsMutex);
+    std::uint64_t dropped = 0;
+    for (const std::unique_ptr<AsyncLogRing>& ring : gLogger_rings)
+        dropped += ring->dropped.load(std::memory_order_relaxed);
+    return dropped;
+}
+
+SR_NAMESPACE_END
@@ -5,6 +5,8 @@
 #include <iostream>
 #include <atomic>
 #include <cstring>
+#include <cstdio>
+#include <cstdint>
 
 SR_NAMESPACE_START
 
@@ -89,6 +91,9 @@ public:
     };
 
     static const int MAX_BUFFER_SIZE = 1024;
+
+    /// Maximum length of a record in asynchronous mode including null terminator, longer one is truncated
+    static const int ASYNC_RECORD_SIZE = 256;
     
 public:
 
@@ -286,9 +291,17 @@ public:
 
     ///
     /// Log to file strem output in thread-safe manner.
+    /// In asynchronous mode, it's formatted then queued without blocking (see startAsync()).
     template <typename... Args>
     inline static void LogAFS(std::FILE* fs, const char* fmt, Args&&... args)
     {
+        if (asyncEnabled.load(std::memory_order_relaxed))
+        {
+            char record[ASYNC_RECORD_SIZE];
+            pushAsync(fs, record, std::snprintf(record, sizeof(record), fmt, std::forward<Args>(args)...));
+            return;
+        }
+
         while (lock.test_and_set(std::memory_order_acquire))
             ;
 
@@ -300,41 +313,76 @@ public:
 
     ///
     /// Log to file stream output with color in thread-safe manner.
+    /// In asynchronous mode, it's formatted then queued without blocking (see startAsync()).
     template <typename... Args>
     inline static void LogAFS(std::FILE* fs, TextColor tc, const char* fmt, Args&&... args)
     {
+        if (asyncEnabled.load(std::memory_order_relaxed))
+        {
+            char colorFmt[MAX_BUFFER_SIZE];
+            if (!makeColorFormat(colorFmt, sizeof(colorFmt), tc, fmt))
+                return;
+            char record[ASYNC_RECORD_SIZE];
+            pushAsync(fs, record, std::snprintf(record, sizeof(record), colorFmt, std::forward<Args>(args)...));
+            return;
+        }
+
         // this also synchronize access to shared buffer to print out string `buffer`
         while (lock.test_and_set(std::memory_order_acquire))
             ;
 
-        int fg;
-
-        switch (tc)
+        if (makeColorFormat(fmtBuffer, sizeof(fmtBuffer), tc, fmt))
         {
-        case TextColor::WHITE: fg = 37; break;
-        case TextColor::RED: fg = 31; break;
-        case TextColor::GREEN: fg = 32; break;
-        case TextColor::BLUE: fg = 34; break;
-        case TextColor::MAGENTA: fg = 35; break;
-        case TextColor::CYAN: fg = 36; break;
-        case TextColor::YELLOW: fg = 33; break;
+            std::fprintf(fs, fmtBuffer, std::forward<Args>(args)...);
+            std::fflush(fs);
         }
 
-        // modify fmt string
-        int bwritten = std::snprintf(fmtBuffer, sizeof(fmtBuffer), "\033[1;%dm", fg);
-        if (bwritten < 0) return;
-        // copy original fmt not included \n
-        std::strncpy(fmtBuffer + bwritten, fmt, strlen(fmt) - 1);
-        std::snprintf(fmtBuffer + bwritten + strlen(fmt) - 1, sizeof(fmtBuffer) - (bwritten+strlen(fmt)), "\033[0m\n");
+        lock.clear();
+    }
 
-        std::fprintf(fs, fmtBuffer, std::forward<Args>(args)...);
-        std::fflush(fs);
+    ///
+    /// Start asynchronous mode of thread-safe logging (LOGA, LOGAE).
+    ///
+    /// Each logging thread formats its record then pushes it into its own bounded ring buffer, and a
+    /// background thread drains all of them into output. Logging from worker threads doesn't wait for
+    /// I/O nor other threads. When ring buffer of a thread is full, its record is dropped and counted.
+    /// Order of records is kept within a thread, but not across threads nor with synchronous logging.
+    /// Ring buffer of exited thread is reused by the next thread, so threads spawned repeatedly don't grow memory.
+    ///
+    /// \param recordsPerThread Capacity of ring buffer of each thread, rounded up to power of two.
+    /// Each record takes ASYNC_RECORD_SIZE bytes. Ring buffers created before keep their capacity.
+    /// \return True if started, or false if it's already started.
+    static bool startAsync(int recordsPerThread=1024);
 
-        lock.clear();
+    ///
+    /// Stop asynchronous mode after writing all queued records, then report dropped records if any.
+    /// Call it after other threads stopped logging.
+    static void stopAsync();
+
+    ///
+    /// Return whether asynchronous mode is active.
+    inline static bool isAsync()
+    {
+        return asyncEnabled.load(std::memory_order_relaxed);
     }
 
+    ///
+    /// Return total number of records dropped by all threads since the program started.
+    static std::uint64_t droppedRecords();
+
 private:
+    ///
+    /// Write `fmt` wrapped by escape codes of color into `buffer`, `fmt` must end with a new line.
+    /// Return false if it doesn't fit.
+    static bool makeColorFormat(char* buffer, int bufferSize, TextColor tc, const char* fmt);
+
+    ///
+    /// Queue formatted record of `length` (as returned by snprintf) into ring buffer of the calling thread.
+    /// Return false if it's dropped.
+    static bool pushAsync(std::FILE* fs, const char* record, int length);
+
     static std::atomic_flag lock;
+    static std::atomic<bool> asyncEnabled;
     static char fmtBuffer[MAX_BUFFER_SIZE];
 };
 
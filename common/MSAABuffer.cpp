@@ -0,0 +1,68 @@
+#include "MSAABuffer.h"
+#include "Parallel.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+SR_NAMESPACE_START
+
+#if defined(__SSE2__)
+///
+/// Sum 4 samples (16 bytes) of a pixel per component, result is in the lower 4 16-bit lanes.
+static inline __m128i sumSamples(const unsigned int* samples)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(samples));
+    const __m128i pairs = _mm_add_epi16(_mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero));
+    return _mm_add_epi16(pairs, _mm_srli_si128(pairs, 8));
+}
+#endif
+
+///
+/// Resolve pixels [begin, end).
+static void resolveMSAARange(const unsigned int* samples, unsigned int* dst, int begin, int end)
+{
+    int i = begin;
+
+#if defined(__SSE2__)
+    // 4 pixels at a time, sums are rounded then narrowed down into 4 packed ARGB pixels
+    const __m128i round = _mm_set1_epi16(kMSAANumSamples / 2);
+    for (; i + 4 <= end; i += 4)
+    {
+        const unsigned int* p = samples + i*kMSAANumSamples;
+        const __m128i s01 = _mm_unpacklo_epi64(sumSamples(p), sumSamples(p + 4));
+        const __m128i s23 = _mm_unpacklo_epi64(sumSamples(p + 8), sumSamples(p + 12));
+        const __m128i avg01 = _mm_srli_epi16(_mm_add_epi16(s01, round), 2);
+        const __m128i avg23 = _mm_srli_epi16(_mm_add_epi16(s23, round), 2);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(avg01, avg23));
+    }
+#endif
+
+    for (; i<end; ++i)
+    {
+        const unsigned int* p = samples + i*kMSAANumSamples;
+        unsigned int pixel = 0;
+        for (int shift=0; shift<32; shift+=8)
+        {
+            unsigned int sum = kMSAANumSamples / 2;
+            for (int s=0; s<kMSAANumSamples; ++s)
+                sum += (p[s] >> shift) & 0xFF;
+            pixel |= (sum / kMSAANumSamples) << shift;
+        }
+        dst[i] = pixel;
+    }
+}
+
+void resolveMSAA(const sr::MSAABuffer& msaa, sr::FrameBuffer& fb, int numThreads)
+{
+    const int width = msaa.getWidth();
+    const unsigned int* samples = msaa.getColorSamples();
+    unsigned int* dst = fb.getFrameBuffer();
+
+    sr::parallelRows(msaa.getHeight(), numThreads, [samples, dst, width](int rowBegin, int rowEnd) {
+        resolveMSAARange(samples, dst, rowBegin * width, rowEnd * width);
+    });
+}
+
+SR_NAMESPACE_END
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "Platform.h"
+#include "Types.h"
+#include "FrameBuffer.h"
+#include "DepthBuffer.h"
+#include "Rasterizer.h"
+#include "Shader.h"
+#include "AlignedAllocator.h"
+
+#include <thread>
+
+SR_NAMESPACE_START
+
+///
+/// Multisample color and depth buffer with kMSAANumSamples (4) samples per pixel.
+///
+/// Samples of a pixel are contiguous, sample `s` of pixel `x + y*width` is at `(x + y*width) * kMSAANumSamples + s`
+/// so one pixel's 4 color samples are 16 bytes, and they're averaged at once with SIMD by resolveMSAA().
+/// Compared to rendering at 4x resolution then downsampling, fragment is shaded only once per pixel and the shaded
+/// color is written into the covered samples, so only pixels on triangle edges end up with different samples.
+class MSAABuffer
+{
+public:
+    ///
+    /// Create buffer with all samples cleared.
+    /// \param width Width of buffer in pixels
+    /// \param height Height of buffer in pixels
+    /// \param clearColor Initial color of all samples
+    /// \param numThreads Number of threads to clear (see firstTouch())
+    MSAABuffer(int width, int height, unsigned int clearColor=0x0, int numThreads=1)
+        : width(width)
+        , height(height)
+    {
+        colorSamples.resize(width * height * kMSAANumSamples);
+        depthSamples.resize(width * height * kMSAANumSamples);
+        clear(clearColor, sr::DepthBuffer::farthest(), numThreads);
+    }
+
+    ///
+    /// Set all color samples to the color, and all depth samples to the depth.
+    void clear(unsigned int color, float depth=sr::DepthBuffer::farthest(), int numThreads=1)
+    {
+        sr::firstTouch(&colorSamples[0], colorSamples.size(), color, numThreads);
+        sr::firstTouch(&depthSamples[0], depthSamples.size(), depth, numThreads);
+    }
+
+    ///
+    /// Write the color into samples of pixel index whose bit is set in coverage mask.
+    inline void write(int index, unsigned int coverage, unsigned int color)
+    {
+        unsigned int* samples = &colorSamples[index * kMSAANumSamples];
+        for (int s=0; s<kMSAANumSamples; ++s)
+        {
+            if (coverage & (1u << s))
+                samples[s] = color;
+        }
+    }
+
+    inline unsigned int* getColorSamples()
+    {
+        return &colorSamples[0];
+    }
+
+    inline const unsigned int* getColorSamples() const
+    {
+        return &colorSamples[0];
+    }
+
+    inline float* getDepthSamples()
+    {
+        return &depthSamples[0];
+    }
+
+    inline const float* getDepthSamples() const
+    {
+        return &depthSamples[0];
+    }
+
+    inline int getWidth() const { return width; }
+    inline int getHeight() const { return height; }
+
+private:
+    int width;
+    int height;
+
+    // 32-bit pixel format ARGB
+    sr::AlignedVector<unsigned int> colorSamples;
+    // greater value is closer
+    sr::AlignedVector<float> depthSamples;
+};
+
+///
+/// Draw triangles with the shader into multisample buffer with per-sample depth testing.
+///
+/// Shader is the same as of drawTriangles() (see Shader.h). Its fragment stage runs once per pixel covered by
+/// at least one sample, and the color replaces all covered samples.
+///
+/// \param shader Shader to process vertices and fragments
+/// \param numFaces Number of faces to draw
+/// \param msaa Target multisample buffer
+/// \param cull Face culling mode
+template <typename ShaderT>
+void drawTrianglesMSAA(ShaderT& shader, int numFaces, sr::MSAABuffer& msaa, sr::CullMode cull=sr::CullMode::NONE)
+{
+    const int kNumVaryings = ShaderT::kNumVaryings;
+    const int width = msaa.getWidth();
+    const int height = msaa.getHeight();
+
+    sr::TriangleSetup<kNumVaryings> setup;
+    for (int i=0; i<numFaces; ++i)
+    {
+        if (!sr::setupFace(shader, i, width, height, cull, setup, sr::kMSAASampleExtent))
+            continue;
+
+        sr::rasterizeTriangleMSAA(setup, msaa.getDepthSamples(), width, [&shader, &msaa](int x, int y, int index, unsigned int coverage, const sr::Varyings<kNumVaryings>& varyings) -> bool {
+            sr::Color32i color;
+            if (!shader.fragment(x, y, varyings, color))
+                return false;
+            msaa.write(index, coverage, color.packed);
+            return true;
+        });
+    }
+}
+
+///
+/// Resolve multisample buffer into framebuffer, each pixel is the average of its samples.
+/// Pixels are averaged with SIMD.
+///
+/// \param msaa Input multisample buffer
+/// \param fb Output framebuffer, must have the same size as multisample buffer
+/// \param numThreads Number of threads resolving bands of rows (see parallelRows())
+void resolveMSAA(const sr::MSAABuffer& msaa, sr::FrameBuffer& fb, int numThreads=std::thread::hardware_concurrency());
+
+SR_NAMESPACE_END
@@ -2,8 +2,8 @@
 
 #include "Platform.h"
 #include "Types.h"
+#include "Random.h"
 
-#include <cstdlib>
 #include <ctime>
 
 SR_NAMESPACE_START
@@ -12,45 +12,46 @@ class MathUtil
 {
 public:
     /// Initialize MathUtil
-    /// only call once
+    /// only call once, random numbers of all threads are reproducible with the same seed
+    /// (see sr::Random::seedThreads())
     static void init(std::time_t seed=std::time(nullptr))
     {
-        std::srand(seed);
+        sr::Random::seedThreads(seed);
     }
 
     ///
     /// Random integer number in range [0,max]
     static inline int randInt(int max)
     {
-        return std::rand() % (max+1);
+        return sr::Random::thread().nextInt(0, max);
     }
 
     ///
     /// Random integer number in range [min, max]
     static inline int randInt2(int min, int max)
     {
-        return std::rand() % (max+1-min) + min;
+        return sr::Random::thread().nextInt(min, max);
     }
 
     ///
-    /// Random floating-point number in range [0.0, 1.0]
+    /// Random floating-point number in range [0.0, 1.0)
     static inline float randFloat()
     {
-        return std::rand() / static_cast<float>(RAND_MAX);
+        return sr::Random::thread().nextFloat();
     }
 
     ///
-    /// Random floating-point number in range [0.0, max]
+    /// Random floating-point number in range [0.0, max)
     static inline float randFloat(float max)
     {
-        return std::rand() / static_cast<float>(RAND_MAX) * max;
+        return sr::Random::thread().nextFloat() * max;
     }
 
     ///
-    /// Random floating-point number in range [min, max]
+    /// Random floating-point number in range [min, max)
     static inline float randFloat2(float min, float max)
     {
-        return static_cast<float>(std::rand()) / (static_cast<float>(RAND_MAX) + 1.0f) * (max+1-min) + min;
+        return sr::Random::thread().nextFloat(min, max);
     }
 
     ///
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Platform.h"
+
+SR_NAMESPACE_START
+
+///
+/// Memory layout policies mapping 2d position (x, y) into index of 1d storage.
+///
+/// Each policy is constructed with dimension of the storage, then it can be asked for total number
+/// of elements to allocate via `size()` (which might be padded to fit the layout), and index of
+/// any position via `index()`. Position must be within the dimension as no bounds checking is done.
+
+///
+/// Compile-time integer log2 for power-of-two value.
+inline constexpr int log2i(int v)
+{
+    return v <= 1 ? 0 : 1 + log2i(v >> 1);
+}
+
+///
+/// Round up input value to the next power of two. Return value as is if it is already power of two.
+inline int nextPowerOfTwo(int v)
+{
+    int p = 1;
+    while (p < v)
+        p <<= 1;
+    return p;
+}
+
+///
+/// Return true if input value is power of two.
+inline constexpr bool isPowerOfTwo(int v)
+{
+    return v > 0 && (v & (v-1)) == 0;
+}
+
+///
+/// Row-major linear layout.
+class LinearLayout
+{
+public:
+    LinearLayout(int width, int height)
+        : width(width)
+        , height(height)
+    {
+    }
+
+    inline int index(int x, int y) const { return x + y*width; }
+    inline int size() const { return width * height; }
+
+private:
+    int width;
+    int height;
+};
+
+///
+/// Tiled layout of squared tile with `TileSize` x `TileSize` elements (must be power of two).
+/// Elements inside a tile are row-major, and tiles are also row-major across the storage.
+/// Dimension is padded up to multiple of `TileSize`.
+template <int TileSize>
+class TiledLayout
+{
+    static_assert(isPowerOfTwo(TileSize), "TileSize must be power of two");
+
+public:
+    static const int kTileSize = TileSize;
+    static const int kTileShift = log2i(TileSize);
+    static const int kTileMask = TileSize - 1;
+
+    TiledLayout(int width, int height)
+        : tilesPerRow((width + kTileMask) >> kTileShift)
+        , tilesPerColumn((height + kTileMask) >> kTileShift)
+    {
+    }
+
+    inline int index(int x, int y) const
+    {
+        const int tile = (y >> kTileShift) * tilesPerRow + (x >> kTileShift);
+        return (tile << (2*kTileShift)) | ((y & kTileMask) << kTileShift) | (x & kTileMask);
+    }
+
+    inline int size() const { return (tilesPerRow * tilesPerColumn) << (2*kTileShift); }
+
+private:
+    int tilesPerRow;
+    int tilesPerColumn;
+};
+
+///
+/// Morton (Z-order) layout.
+/// Dimension is padded up to power of two. For non-squared dimension, lower bits of both axes are
+/// interleaved up to the smaller dimension, then remaining bits of the longer axis are placed on top.
+class MortonLayout
+{
+public:
+    MortonLayout(int width, int height)
+        : paddedWidth(nextPowerOfTwo(width))
+        , paddedHeight(nextPowerOfTwo(height))
+    {
+        interleavedBits = log2i(paddedWidth < paddedHeight ? paddedWidth : paddedHeight);
+        interleavedMask = (1 << interleavedBits) - 1;
+    }
+
+    inline int index(int x, int y) const
+    {
+        // only one of x or y can have bits left above interleaved bits
+        const int upper = ((x | y) >> interleavedBits) << (2*interleavedBits);
+        return upper | spreadBits(x & interleavedMask) | (spreadBits(y & interleavedMask) << 1);
+    }
+
+    inline int size() const { return paddedWidth * paddedHeight; }
+
+    ///
+    /// Spread lower 16 bits of input value to even bits of the result.
+    static inline unsigned int spreadBits(unsigned int v)
+    {
+        v = (v | (v << 8)) & 0x00FF00FF;
+        v = (v | (v << 4)) & 0x0F0F0F0F;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    }
+
+private:
+    int paddedWidth;
+    int paddedHeight;
+    int interleavedBits;
+    int interleavedMask;
+};
+
+SR_NAMESPACE_END
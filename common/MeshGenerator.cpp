@@ -0,0 +1,101 @@
+#include "MeshGenerator.h"
+#include "Random.h"
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+SR_NAMESPACE_START
+
+///
+/// Random number in [-1, 1] roughly normally distributed, as sum of three uniform numbers.
+static inline float randBell(sr::Random& random)
+{
+    return (random.nextFloat() + random.nextFloat() + random.nextFloat()) / 1.5f - 1.0f;
+}
+
+ObjData generateMesh(const MeshGeneratorParams& params)
+{
+    const float kPi = 3.14159265358979f;
+    const int numTriangles = std::max(0, params.numTriangles);
+    const float halfExtent = std::sqrt(std::min(1.0f, std::max(0.0f, params.coverage)));
+    const float minSizeRatio = std::min(1.0f, std::max(1e-6f, params.minSizeRatio));
+
+    // own generator, so generating doesn't disturb random numbers of the calling thread
+    sr::Random random(params.seed);
+
+    // relative area of each triangle, then scale them so total area is depth complexity times covered area
+    std::vector<float> areas(numTriangles, 1.0f);
+    if (numTriangles > 0 && params.sizeDistribution != SizeDistribution::FIXED)
+    {
+        random.fillFloats(&areas[0], numTriangles, 0.0f, 1.0f);
+        for (float& area : areas)
+        {
+            if (params.sizeDistribution == SizeDistribution::UNIFORM)
+                area = minSizeRatio + (1.0f - minSizeRatio) * area;
+            else
+                area = std::pow(minSizeRatio, 1.0f - area);
+        }
+    }
+    double sumAreas = 0.0;
+    for (float area : areas)
+        sumAreas += area;
+    const float coveredArea = 4.0f * halfExtent * halfExtent;
+    const float areaScale = sumAreas > 0.0 ? static_cast<float>(params.depthComplexity * coveredArea / sumAreas) : 0.0f;
+
+    std::vector<sr::Vec2f> clusters(std::max(0, params.numClusters));
+    for (sr::Vec2f& c : clusters)
+        c = sr::Vec2f(random.nextFloat(-halfExtent, halfExtent), random.nextFloat(-halfExtent, halfExtent));
+    const float clusterRadius = params.clusterRadius * halfExtent;
+
+    ObjData mesh;
+    mesh.vertices.reserve(numTriangles * 3);
+    mesh.faces.reserve(numTriangles);
+
+    for (int i=0; i<numTriangles; ++i)
+    {
+        sr::Vec2f center;
+        if (clusters.empty())
+        {
+            center = sr::Vec2f(random.nextFloat(-halfExtent, halfExtent), random.nextFloat(-halfExtent, halfExtent));
+        }
+        else
+        {
+            const sr::Vec2f& c = clusters[random.nextInt(0, clusters.size() - 1)];
+            center.x = std::min(halfExtent, std::max(-halfExtent, c.x + randBell(random) * clusterRadius));
+            center.y = std::min(halfExtent, std::max(-halfExtent, c.y + randBell(random) * clusterRadius));
+        }
+
+        // corners on unit circle in increasing angle so triangle is counter-clockwise, each one jittered
+        // by at most 1/4 of spacing to keep the order
+        const float rotation = random.nextFloat(0.0f, 2.0f * kPi);
+        sr::Vec2f corners[3];
+        for (int j=0; j<3; ++j)
+        {
+            const float angle = rotation + (j + (random.nextFloat() - 0.5f) * 0.5f) * 2.0f * kPi / 3.0f;
+            corners[j] = sr::Vec2f(std::cos(angle), std::sin(angle));
+        }
+        const float unitArea = 0.5f * ((corners[1].x - corners[0].x) * (corners[2].y - corners[0].y) - (corners[2].x - corners[0].x) * (corners[1].y - corners[0].y));
+        const float scale = std::sqrt(areas[i] * areaScale / unitArea);
+
+        // plane through the center at random depth, tilted a little
+        const float depth = random.nextFloat(-0.7f, 0.7f);
+        const float slopeX = random.nextFloat(-0.25f, 0.25f);
+        const float slopeY = random.nextFloat(-0.25f, 0.25f);
+
+        const unsigned int base = mesh.vertices.size();
+        for (int j=0; j<3; ++j)
+        {
+            const float dx = corners[j].x * scale;
+            const float dy = corners[j].y * scale;
+            const float z = std::min(1.0f, std::max(-1.0f, depth + slopeX * dx + slopeY * dy));
+            mesh.vertices.push_back(sr::Vec3f(center.x + dx, center.y + dy, z));
+        }
+        mesh.faces.push_back(std::vector<unsigned int>{ base, base + 1, base + 2 });
+    }
+
+    mesh.computeFaceNormals();
+    return mesh;
+}
+
+SR_NAMESPACE_END
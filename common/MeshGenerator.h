@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Platform.h"
+#include "ObjLoader.h"
+
+SR_NAMESPACE_START
+
+///
+/// Distribution of triangle sizes for generateMesh()
+enum class SizeDistribution
+{
+    // all triangles have the same area
+    FIXED,
+    // area is uniformly distributed in [minSizeRatio, 1] relative to the largest triangle
+    UNIFORM,
+    // area is log-uniformly distributed in [minSizeRatio, 1], many small triangles and few large ones
+    LOG_UNIFORM
+};
+
+///
+/// Parameters of generateMesh(). All positions are in [-1, 1] on each axis, x and y are screen axes,
+/// and greater z is closer to the viewer.
+struct MeshGeneratorParams
+{
+    // number of triangles to generate
+    int numTriangles;
+    // fraction [0, 1] of the screen triangles are placed in, as a square centered on the screen
+    float coverage;
+    // average number of triangles covering a pixel inside the covered area. It sets total area of triangles.
+    float depthComplexity;
+    // distribution of triangle sizes
+    SizeDistribution sizeDistribution;
+    // area of the smallest triangle relative to the largest one, for UNIFORM and LOG_UNIFORM
+    float minSizeRatio;
+    // number of clusters triangles are gathered around, 0 to spread them uniformly over the covered area
+    int numClusters;
+    // radius of cluster relative to half size of the covered area
+    float clusterRadius;
+    // seed of random numbers, the same parameters and seed always generate the same mesh
+    unsigned int seed;
+
+    MeshGeneratorParams()
+        : numTriangles(1000)
+        , coverage(1.0f)
+        , depthComplexity(1.0f)
+        , sizeDistribution(SizeDistribution::FIXED)
+        , minSizeRatio(0.1f)
+        , numClusters(0)
+        , clusterRadius(0.2f)
+        , seed(1)
+    {
+    }
+};
+
+///
+/// Generate triangles deterministically from parameters, without external assets, to benchmark rendering
+/// of varying workloads. Triangles don't share vertices, and they're counter-clockwise facing the viewer
+/// so none is culled by sr::CullMode::BACK. Each one is slightly tilted so flat shading varies across them.
+/// Face normals are computed as well.
+///
+/// \param params Parameters of the mesh
+/// \return Generated mesh
+ObjData generateMesh(const MeshGeneratorParams& params);
+
+SR_NAMESPACE_END
@@ -0,0 +1,48 @@
+#include "OITBuffer.h"
+#include "Parallel.h"
+
+#include <vector>
+
+SR_NAMESPACE_START
+
+///
+/// Resolve pixels [begin, end).
+static void resolveOITRange(const sr::OITBuffer& oit, unsigned int* pixels, int begin, int end)
+{
+    const sr::Color32f* accumulation = oit.getAccumulation();
+    const float* revealage = oit.getRevealage();
+
+    for (int i=begin; i<end; ++i)
+    {
+        const float reveal = revealage[i];
+        // nothing translucent on this pixel
+        if (reveal >= 1.0f)
+            continue;
+
+        const sr::Color32f& accum = accumulation[i];
+        const float coverage = 1.0f - reveal;
+        // average color scaled by coverage, then into 8-bit range
+        const float scale = coverage * 255.0f / std::max(accum.a, 1e-5f);
+        const unsigned int dst = pixels[i];
+        const float r = std::min(255.0f, accum.r * scale + ((dst >> 16) & 0xFF) * reveal);
+        const float g = std::min(255.0f, accum.g * scale + ((dst >> 8) & 0xFF) * reveal);
+        const float b = std::min(255.0f, accum.b * scale + (dst & 0xFF) * reveal);
+        const float a = std::min(255.0f, coverage * 255.0f + (dst >> 24) * reveal);
+        pixels[i] = (static_cast<unsigned int>(a + 0.5f) << 24) |
+                    (static_cast<unsigned int>(r + 0.5f) << 16) |
+                    (static_cast<unsigned int>(g + 0.5f) << 8) |
+                    static_cast<unsigned int>(b + 0.5f);
+    }
+}
+
+void resolveOIT(const sr::OITBuffer& oit, sr::FrameBuffer& fb, int numThreads)
+{
+    const int width = oit.getWidth();
+    unsigned int* pixels = fb.getFrameBuffer();
+
+    sr::parallelRows(oit.getHeight(), numThreads, [&oit, pixels, width](int rowBegin, int rowEnd) {
+        resolveOITRange(oit, pixels, rowBegin * width, rowEnd * width);
+    });
+}
+
+SR_NAMESPACE_END
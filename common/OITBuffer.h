@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Platform.h"
+#include "Types.h"
+#include "FrameBuffer.h"
+#include "Rasterizer.h"
+#include "Shader.h"
+#include "AlignedAllocator.h"
+
+#include <thread>
+#include <algorithm>
+
+SR_NAMESPACE_START
+
+///
+/// Accumulation buffer for weighted blended order-independent transparency (McGuire and Bavoil 2013).
+///
+/// Translucent fragments are accumulated in any order into two planes
+///  - accumulation, sum of premultiplied color weighted by depth (rgb * a * w, a * w)
+///  - revealage, product of (1 - a) which is how much of the background is still visible
+/// then resolved once over the opaque framebuffer with resolveOIT(). No sorting is needed, and memory is
+/// fixed regardless of depth complexity. Result is an approximation that is exact for fragments of the same color.
+class OITBuffer
+{
+public:
+    ///
+    /// \param width Width of buffer
+    /// \param height Height of buffer
+    /// \param nearDepth Depth value of the nearest translucent fragment expected, greater value is closer
+    /// \param farDepth Depth value of the farthest translucent fragment expected
+    OITBuffer(int width, int height, float nearDepth, float farDepth)
+        : width(width)
+        , height(height)
+        , nearDepth(nearDepth)
+        , invDepthRange(1.0f / (nearDepth - farDepth))
+    {
+        accumulation.resize(width * height);
+        revealage.resize(width * height);
+        clear();
+    }
+
+    ///
+    /// Reset to nothing accumulated.
+    void clear(int numThreads=1)
+    {
+        sr::firstTouch(&accumulation[0], accumulation.size(), sr::Color32f(0.0f, 0.0f, 0.0f, 0.0f), numThreads);
+        sr::firstTouch(&revealage[0], revealage.size(), 1.0f, numThreads);
+    }
+
+    ///
+    /// Accumulate translucent fragment at pixel index.
+    /// \param index Index of pixel
+    /// \param color Straight (not premultiplied) color of fragment, alpha is its opacity
+    /// \param depth Depth of fragment, greater value is closer
+    inline void accumulate(int index, const sr::Color32f& color, float depth)
+    {
+        // weight falls off with distance so nearer fragments dominate, equation (10) of the paper
+        const float d = std::min(1.0f, std::max(0.0f, (nearDepth - depth) * invDepthRange));
+        const float oneMinusD = 1.0f - d;
+        const float w = color.a * std::max(1e-2f, 3e3f * oneMinusD * oneMinusD * oneMinusD);
+
+        sr::Color32f& accum = accumulation[index];
+        accum.r += color.r * w;
+        accum.g += color.g * w;
+        accum.b += color.b * w;
+        accum.a += w;
+        revealage[index] *= 1.0f - color.a;
+    }
+
+    inline const sr::Color32f* getAccumulation() const { return &accumulation[0]; }
+    inline const float* getRevealage() const { return &revealage[0]; }
+
+    inline int getWidth() const { return width; }
+    inline int getHeight() const { return height; }
+
+private:
+    int width;
+    int height;
+    float nearDepth;
+    float invDepthRange;
+
+    sr::AlignedVector<sr::Color32f> accumulation;
+    sr::AlignedVector<float> revealage;
+};
+
+///
+/// Draw translucent triangles with the shader into OIT buffer, in any order.
+///
+/// Shader is the same as of drawTriangles() (see Shader.h), alpha of fragment color is its opacity.
+/// Fragments are depth tested against z-buffer of opaque geometry, but depth is not written so translucent
+/// fragments behind other translucent ones still contribute.
+///
+/// \param shader Shader to process vertices and fragments
+/// \param numFaces Number of faces to draw
+/// \param oit Target OIT buffer
+/// \param zBuffer Depth buffer of opaque geometry, greater value is closer
+/// \param cull Face culling mode, translucent geometry usually shows its back faces
+template <typename ShaderT>
+void drawTrianglesOIT(ShaderT& shader, int numFaces, sr::OITBuffer& oit, float zBuffer[], sr::CullMode cull=sr::CullMode::NONE)
+{
+    const int kNumVaryings = ShaderT::kNumVaryings;
+    const int width = oit.getWidth();
+    const float kInv255 = 1.0f / 255.0f;
+
+    sr::TriangleSetup<kNumVaryings> setup;
+    for (int i=0; i<numFaces; ++i)
+    {
+        if (!sr::setupFace(shader, i, width, oit.getHeight(), cull, setup))
+            continue;
+
+        const sr::PlaneEquation& depth = setup.depth;
+        sr::rasterizeTriangle<sr::DepthTest::GREATER, sr::DepthWrite::DISABLED>(setup, zBuffer, width, [&shader, &oit, &depth, kInv255](int x, int y, int index, const sr::Varyings<kNumVaryings>& varyings) -> bool {
+            sr::Color32i color;
+            if (!shader.fragment(x, y, varyings, color))
+                return false;
+            oit.accumulate(index, sr::Color32f(color.r * kInv255, color.g * kInv255, color.b * kInv255, color.a * kInv255),
+                           depth.eval(static_cast<float>(x), static_cast<float>(y)));
+            return true;
+        });
+    }
+}
+
+///
+/// Composite accumulated translucent fragments over framebuffer holding opaque geometry.
+/// out = average color * (1 - revealage) + opaque * revealage
+///
+/// \param oit Input OIT buffer
+/// \param fb Framebuffer with opaque geometry already rendered, must have the same size as OIT buffer
+/// \param numThreads Number of threads resolving bands of rows (see parallelRows())
+void resolveOIT(const sr::OITBuffer& oit, sr::FrameBuffer& fb, int numThreads=std::thread::hardware_concurrency());
+
+SR_NAMESPACE_END
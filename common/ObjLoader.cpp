@@ -1,6 +1,7 @@
 #include "ObjLoader.h"
 
 #include "Logger.h"
+#include "Vec3Packet.h"
 
 #include <iostream>
 #include <cstdio>
@@ -10,6 +11,7 @@
 #include <vector>
 #include <sstream>
 #include <fstream>
+#include <algorithm>
 
 SR_NAMESPACE_START
 
@@ -18,6 +20,7 @@ ObjData::ObjData(const ObjData& other)
     // make a copy from other
     vertices = other.vertices;
     faces = other.faces;
+    faceNormals = other.faceNormals;
 }
 
 ObjData::ObjData(ObjData&& other)
@@ -25,6 +28,7 @@ ObjData::ObjData(ObjData&& other)
     // swap the data content pointed to by vector
     vertices.swap(other.vertices);
     faces.swap(other.faces);
+    faceNormals.swap(other.faceNormals);
 }
 
 ObjData& ObjData::operator=(const ObjData& other)
@@ -35,6 +39,7 @@ ObjData& ObjData::operator=(const ObjData& other)
     // make a copy
     vertices = other.vertices;
     faces = other.faces;
+    faceNormals = other.faceNormals;
 
     return *this;
 }
@@ -46,6 +51,7 @@ ObjData& ObjData::operator=(ObjData&& other)
 
     vertices.swap(other.vertices);
     faces.swap(other.faces);
+    faceNormals.swap(other.faceNormals);
 
     return *this;
 }
@@ -54,6 +60,41 @@ void swap(ObjData& first, ObjData& second) noexcept
 {
     first.vertices.swap(second.vertices);
     first.faces.swap(second.faces);
+    first.faceNormals.swap(second.faceNormals);
+}
+
+void ObjData::computeFaceNormals()
+{
+    const int kWidth = sr::Vec3f_x8::kWidth;
+    faceNormals.resize(faces.size());
+
+    for (size_t i=0; i<faces.size(); i+=kWidth)
+    {
+        // gather vertices of up to 8 faces, missing ones at the end stay zero
+        sr::Vec3f corners[3][kWidth];
+        const int count = static_cast<int>(std::min<size_t>(kWidth, faces.size() - i));
+        for (int j=0; j<count; ++j)
+        {
+            const std::vector<unsigned int>& f = faces[i + j];
+            for (int k=0; k<3; ++k)
+            {
+                const sr::Vec3f& v = vertices[f[k]];
+                corners[k][j].x = v.x;
+                corners[k][j].y = v.y;
+                corners[k][j].z = v.z;
+            }
+        }
+
+        sr::Vec3f_x8 p0;
+        sr::Vec3f_x8 p1;
+        sr::Vec3f_x8 p2;
+        sr::loadVec3fPacket(corners[0], p0);
+        sr::loadVec3fPacket(corners[1], p1);
+        sr::loadVec3fPacket(corners[2], p2);
+        sr::Vec3f_x8 normals = sr::cross(p1 - p0, p2 - p0);
+        normals.normalize();
+        sr::storeVec3fPacket(normals, faceNormals, i);
+    }
 }
 
 bool ObjLoader::loadObjFile(const char* filepath, ObjData& dataOut)
@@ -103,6 +144,7 @@ bool ObjLoader::loadObjFile(const char* filepath, ObjData& dataOut)
     }
 
     filein.close();
+    dataOut.computeFaceNormals();
     return true;
 }
 
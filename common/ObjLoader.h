@@ -15,6 +15,8 @@ struct ObjData
 {
     std::vector<sr::Vec3f> vertices;
     std::vector<std::vector<unsigned int>> faces;
+    /// normalized normal of each face from its counter-clockwise vertices, see computeFaceNormals()
+    std::vector<sr::Vec3f> faceNormals;
     /// ... will be more data to load i.e. normals, texture-coord
 
     ObjData() = default;
@@ -24,6 +26,11 @@ struct ObjData
     ObjData& operator=(const ObjData& other);
     ObjData& operator=(ObjData&& other);
     friend void swap(ObjData& first, ObjData& second) noexcept;
+
+    ///
+    /// Compute faceNormals from vertices and faces, 8 faces at a time in SoA form.
+    /// Call it again whenever vertices or faces are modified. Normal of degenerated face is zero.
+    void computeFaceNormals();
 };
 
 class ObjLoader
@@ -31,7 +38,7 @@ class ObjLoader
 public:
     ///
     /// Load .obj file then return result of formed vertices.
-    /// Load vertex, texture coordinate and normals.
+    /// Load vertex, texture coordinate and normals. Face normals are computed once loaded.
     ///
     /// \param filepath file path of .obj file to parse
     /// \param dataOut Data output to be set when it successfully loaded.
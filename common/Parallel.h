@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Platform.h"
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+SR_NAMESPACE_START
+
+///
+/// Number of items in each chunk when `count` items are split into chunks of equal size, one per thread.
+/// \param count Number of items
+/// \param numThreads Number of threads, it's clamped to [1, count]
+inline int chunkSize(int count, int numThreads)
+{
+    numThreads = std::max(1, std::min(numThreads, count));
+    return (count + numThreads - 1) / numThreads;
+}
+
+///
+/// Split items [0, count) into contiguous chunks of equal size (see chunkSize()), one per thread, and call
+/// `fn(int chunk, int begin, int end)` for each chunk concurrently. The calling thread takes the first chunk,
+/// and it returns once all chunks are done.
+///
+/// \param count Number of items
+/// \param numThreads Number of threads, it's clamped to [1, count]
+/// \param fn Callable object processing a chunk of items, it must be safe to be called concurrently
+template <typename Func>
+void parallelChunks(int count, int numThreads, Func&& fn)
+{
+    numThreads = std::max(1, std::min(numThreads, count));
+    const int itemsPerThread = chunkSize(count, numThreads);
+
+    std::vector<std::thread> threads;
+    for (int i=1; i<numThreads; ++i)
+        threads.emplace_back([&fn, count, itemsPerThread, i]() {
+            fn(i, std::min(count, i*itemsPerThread), std::min(count, (i+1)*itemsPerThread));
+        });
+    fn(0, 0, std::min(count, itemsPerThread));
+    for (std::thread& t : threads)
+        t.join();
+}
+
+///
+/// Split rows [0, height) into contiguous bands of equal height, one per thread, and call
+/// `fn(int rowBegin, int rowEnd)` for each band concurrently. The calling thread takes the first band,
+/// and it returns once all bands are done. Band i starts at row i * chunkSize(height, numThreads).
+///
+/// Passes over whole buffer (resolve, deferred shading) use it, so each thread touches only its own rows,
+/// close to the chunks sr::firstTouch() places on each thread's NUMA node with the same number of threads.
+///
+/// \param height Number of rows
+/// \param numThreads Number of threads, it's clamped to [1, height]
+/// \param fn Callable object processing a band of rows, it must be safe to be called concurrently
+template <typename Func>
+void parallelRows(int height, int numThreads, Func&& fn)
+{
+    parallelChunks(height, numThreads, [&fn](int, int rowBegin, int rowEnd) {
+        fn(rowBegin, rowEnd);
+    });
+}
+
+SR_NAMESPACE_END
@@ -6,3 +6,6 @@
 #define SR_NAMESPACE_USING using namespace sr;
 
 #define SR_MEM_ALIGN(bytes) __attribute__((aligned(bytes)))
+
+/// Size of cache line in bytes, used to align memory shared by threads
+#define SR_CACHE_LINE_SIZE 64
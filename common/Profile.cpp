@@ -1,3 +1,396 @@
 #include "Profile.h"
 
-std::chrono::steady_clock::time_point sr::Profile::gProfile_startTime;
+#include <mutex>
+#include <memory>
+#include <cstring>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <cerrno>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
+
+SR_NAMESPACE_START
+
+std::chrono::steady_clock::time_point Profile::gProfile_startTime;
+std::atomic<bool> Profile::gProfile_countersEnabled(false);
+
+const int ProfileThreadBuffer::kInitialCapacity;
+const int ProfileThreadBuffer::kCapacity;
+const int ProfileThreadBuffer::kCountersNotOpened;
+const int ProfileThreadBuffer::kCountersUnavailable;
+
+/// Name of each counter as shown in reports, in order of ProfileCounter
+static const char* kProfileCounterNames[PROFILE_NUM_COUNTERS] = { "cycles", "instructions", "cache-misses", "branch-misses" };
+
+///
+/// Event buffers of all threads which ever recorded a zone, in order of registration, buffers of exited
+/// threads ready to be reused, and name of each thread by thread index
+static std::mutex gProfile_threadsMutex;
+static std::vector<std::unique_ptr<ProfileThreadBuffer>> gProfile_threads;
+static std::vector<ProfileThreadBuffer*> gProfile_freeThreads;
+static std::vector<std::string> gProfile_threadNames;
+
+#if defined(__linux__)
+///
+/// Open counter of the calling thread in user space only, return file descriptor or -1 if failed.
+/// Group leader is opened disabled, then the whole group is enabled at once after all members are opened.
+static int openCounter(std::uint32_t type, std::uint64_t config, int groupFd)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = groupFd == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+#endif
+
+ProfileThreadBuffer::~ProfileThreadBuffer()
+{
+    releaseCounters();
+}
+
+void ProfileThreadBuffer::releaseCounters()
+{
+#if defined(__linux__)
+    if (counterGroup >= 0)
+    {
+        for (int i=0; i<PROFILE_NUM_COUNTERS; ++i)
+            close(counterFds[i]);
+    }
+#endif
+    counterGroup = kCountersNotOpened;
+}
+
+bool ProfileThreadBuffer::readCounters(std::uint64_t out[PROFILE_NUM_COUNTERS])
+{
+#if defined(__linux__)
+    if (counterGroup == kCountersNotOpened)
+    {
+        static const std::uint64_t kConfigs[PROFILE_NUM_COUNTERS] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+
+        int opened = 0;
+        for (; opened<PROFILE_NUM_COUNTERS; ++opened)
+        {
+            counterFds[opened] = openCounter(PERF_TYPE_HARDWARE, kConfigs[opened], opened == 0 ? -1 : counterFds[0]);
+            if (counterFds[opened] < 0)
+                break;
+        }
+
+        if (opened < PROFILE_NUM_COUNTERS)
+        {
+            // warn only once for all threads
+            static std::atomic<bool> warned(false);
+            if (!warned.exchange(true))
+                LOGE("Profile: hardware counter %s is not available (%s), zones are timed without counters\n", kProfileCounterNames[opened], std::strerror(errno));
+            for (int i=0; i<opened; ++i)
+                close(counterFds[i]);
+            counterGroup = kCountersUnavailable;
+        }
+        else
+        {
+            counterGroup = counterFds[0];
+            ioctl(counterGroup, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    if (counterGroup < 0)
+        return false;
+
+    // with PERF_FORMAT_GROUP, number of counters is followed by value of each one in order they were opened
+    std::uint64_t values[1 + PROFILE_NUM_COUNTERS];
+    if (read(counterGroup, values, sizeof(values)) != static_cast<ssize_t>(sizeof(values)))
+        return false;
+    for (int i=0; i<PROFILE_NUM_COUNTERS; ++i)
+        out[i] = values[1 + i];
+    return true;
+#else
+    (void)out;
+    if (counterGroup == kCountersNotOpened)
+    {
+        LOGE("Profile: hardware counters are only supported on Linux\n");
+        counterGroup = kCountersUnavailable;
+    }
+    return false;
+#endif
+}
+
+std::uint64_t ProfileThreadBuffer::snapshot(std::vector<ProfileEvent>& out) const
+{
+    const std::uint64_t h = head.load(std::memory_order_acquire);
+    const std::uint64_t capacity = events.size();
+    const std::uint64_t count = std::min(h, capacity);
+    for (std::uint64_t i=h-count; i<h; ++i)
+        out.push_back(events[i & (capacity - 1)]);
+    return h - count;
+}
+
+void Profile::enableCounters(bool enable)
+{
+    gProfile_countersEnabled.store(enable, std::memory_order_relaxed);
+}
+
+ProfileThreadBuffer* Profile::acquireThreadBuffer()
+{
+    std::lock_guard<std::mutex> guard(gProfile_threadsMutex);
+    ProfileThreadBuffer* buffer;
+    if (!gProfile_freeThreads.empty())
+    {
+        buffer = gProfile_freeThreads.back();
+        gProfile_freeThreads.pop_back();
+    }
+    else
+    {
+        gProfile_threads.emplace_back(new ProfileThreadBuffer());
+        buffer = gProfile_threads.back().get();
+    }
+    // every acquisition is a new thread even if the buffer is reused
+    buffer->setThreadIndex(static_cast<int>(gProfile_threadNames.size()));
+    gProfile_threadNames.push_back(std::string());
+    return buffer;
+}
+
+void Profile::releaseThreadBuffer(ProfileThreadBuffer* buffer)
+{
+    // counters are bound to the exiting thread
+    buffer->releaseCounters();
+    buffer->depth = 0;
+
+    std::lock_guard<std::mutex> guard(gProfile_threadsMutex);
+    gProfile_freeThreads.push_back(buffer);
+}
+
+void Profile::setThreadName(const char* name)
+{
+    const int thread = threadBuffer().getThreadIndex();
+    std::lock_guard<std::mutex> guard(gProfile_threadsMutex);
+    gProfile_threadNames[thread] = name;
+}
+
+///
+/// Copy out events held in all buffers grouped by index of the thread which recorded them.
+/// It has to be called with gProfile_threadsMutex locked.
+static void snapshotThreads(std::vector<std::vector<ProfileEvent>>& threadEvents)
+{
+    threadEvents.assign(gProfile_threadNames.size(), std::vector<ProfileEvent>());
+    std::vector<ProfileEvent> events;
+    for (const std::unique_ptr<ProfileThreadBuffer>& buffer : gProfile_threads)
+    {
+        events.clear();
+        const std::uint64_t dropped = buffer->snapshot(events);
+        if (dropped > 0)
+            LOGE("Profile: buffer of thread %d dropped %lu oldest events\n", buffer->getThreadIndex(), static_cast<unsigned long>(dropped));
+        for (const ProfileEvent& e : events)
+            threadEvents[e.thread].push_back(e);
+    }
+}
+
+std::vector<ProfileZoneStats> Profile::collectZones()
+{
+    std::lock_guard<std::mutex> guard(gProfile_threadsMutex);
+
+    std::vector<std::vector<ProfileEvent>> threadEvents;
+    snapshotThreads(threadEvents);
+
+    std::vector<ProfileZoneStats> result;
+    std::vector<double> durations;
+    for (size_t t=0; t<threadEvents.size(); ++t)
+    {
+        std::vector<ProfileEvent>& events = threadEvents[t];
+
+        // zones are pushed when they end, so sort by start to report outer zone before its nested ones
+        std::stable_sort(events.begin(), events.end(), [](const ProfileEvent& a, const ProfileEvent& b) -> bool {
+            return a.start < b.start;
+        });
+
+        std::vector<bool> visited(events.size(), false);
+        for (size_t i=0; i<events.size(); ++i)
+        {
+            if (visited[i] || events[i].type != ProfileEventType::ZONE)
+                continue;
+
+            // gather all events of the same zone, name pointer may differ across translation units
+            durations.clear();
+            int numWithCounters = 0;
+            double counterSums[PROFILE_NUM_COUNTERS] = {};
+            for (size_t j=i; j<events.size(); ++j)
+            {
+                if (!visited[j] && events[j].type == ProfileEventType::ZONE && events[j].depth == events[i].depth &&
+                    (events[j].name == events[i].name || std::strcmp(events[j].name, events[i].name) == 0))
+                {
+                    visited[j] = true;
+                    durations.push_back((events[j].end - events[j].start) * 1e-3);
+                    if (events[j].hasCounters)
+                    {
+                        ++numWithCounters;
+                        for (int k=0; k<PROFILE_NUM_COUNTERS; ++k)
+                            counterSums[k] += static_cast<double>(events[j].counters[k]);
+                    }
+                }
+            }
+            std::sort(durations.begin(), durations.end());
+
+            ProfileZoneStats stats;
+            stats.name = events[i].name;
+            stats.threadIndex = static_cast<int>(t);
+            stats.depth = events[i].depth;
+            stats.count = static_cast<int>(durations.size());
+            stats.min = durations.front();
+            stats.total = 0.0;
+            for (double d : durations)
+                stats.total += d;
+            stats.mean = stats.total / stats.count;
+            // nearest-rank percentile
+            stats.p99 = durations[std::max(0, static_cast<int>(std::ceil(0.99 * stats.count)) - 1)];
+            stats.hasCounters = numWithCounters > 0;
+            for (int k=0; k<PROFILE_NUM_COUNTERS; ++k)
+                stats.counters[k] = stats.hasCounters ? counterSums[k] / numWithCounters : 0.0;
+            result.push_back(stats);
+        }
+    }
+    return result;
+}
+
+void Profile::report()
+{
+    const std::vector<ProfileZoneStats> zones = collectZones();
+    int thread = -1;
+    for (const ProfileZoneStats& z : zones)
+    {
+        if (z.threadIndex != thread)
+        {
+            thread = z.threadIndex;
+            std::string threadName;
+            {
+                std::lock_guard<std::mutex> guard(gProfile_threadsMutex);
+                threadName = gProfile_threadNames[thread];
+            }
+            if (threadName.empty())
+                LOG("Profile thread %d\n", thread);
+            else
+                LOG("Profile thread %d (%s)\n", thread, threadName.c_str());
+            LOG("  %-32s %8s %12s %12s %12s %12s\n", "zone", "count", "min (us)", "mean (us)", "p99 (us)", "total (us)");
+        }
+        // indent nested zones under their parent
+        const std::string name = std::string(z.depth * 2, ' ') + z.name;
+        LOG("  %-32s %8d %12.2f %12.2f %12.2f %12.2f\n", name.c_str(), z.count, z.min, z.mean, z.p99, z.total);
+        if (z.hasCounters)
+        {
+            const double ipc = z.counters[PROFILE_COUNTER_CYCLES] > 0.0 ? z.counters[PROFILE_COUNTER_INSTRUCTIONS] / z.counters[PROFILE_COUNTER_CYCLES] : 0.0;
+            LOG("  %-32s mean cycles %.0f, instructions %.0f (IPC %.2f), cache misses %.1f, branch misses %.1f\n", "",
+                    z.counters[PROFILE_COUNTER_CYCLES], z.counters[PROFILE_COUNTER_INSTRUCTIONS], ipc,
+                    z.counters[PROFILE_COUNTER_CACHE_MISSES], z.counters[PROFILE_COUNTER_BRANCH_MISSES]);
+        }
+    }
+}
+
+///
+/// Write string as JSON string literal.
+static void writeJSONString(std::FILE* out, const char* str)
+{
+    std::fputc('"', out);
+    for (const char* c=str; *c != '\0'; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+            std::fputc('\\', out);
+        if (static_cast<unsigned char>(*c) < 0x20)
+            std::fprintf(out, "\\u%04x", *c);
+        else
+            std::fputc(*c, out);
+    }
+    std::fputc('"', out);
+}
+
+bool Profile::writeChromeTrace(const char* filename)
+{
+    std::lock_guard<std::mutex> guard(gProfile_threadsMutex);
+
+    std::vector<std::vector<ProfileEvent>> threadEvents;
+    snapshotThreads(threadEvents);
+    std::uint64_t origin = std::numeric_limits<std::uint64_t>::max();
+    for (const std::vector<ProfileEvent>& events : threadEvents)
+    {
+        for (const ProfileEvent& e : events)
+            origin = std::min(origin, e.start);
+    }
+
+    std::FILE* out = std::fopen(filename, "wb");
+    if (out == nullptr)
+    {
+        LOGE("Error attempting to open file %s for writing\n", filename);
+        return false;
+    }
+
+    std::fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (size_t t=0; t<threadEvents.size(); ++t)
+    {
+        // threads whose events were all cleared or overwritten have no track
+        if (threadEvents[t].empty())
+            continue;
+        const int tid = static_cast<int>(t);
+
+        // metadata naming the track, and keeping tracks in order threads started recording
+        const std::string& threadName = gProfile_threadNames[t];
+        std::fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",\n", tid);
+        if (threadName.empty())
+            std::fprintf(out, "\"thread %d\"", tid);
+        else
+            writeJSONString(out, threadName.c_str());
+        std::fprintf(out, "}},\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"sort_index\":%d}}", tid, tid);
+        first = false;
+
+        for (const ProfileEvent& e : threadEvents[t])
+        {
+            std::fprintf(out, ",\n{\"name\":");
+            writeJSONString(out, e.name);
+            const double ts = (e.start - origin) * 1e-3;
+            if (e.type == ProfileEventType::FRAME_MARKER)
+                std::fprintf(out, ",\"cat\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}", tid, ts);
+            else
+            {
+                std::fprintf(out, ",\"cat\":\"zone\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f", tid, ts, (e.end - e.start) * 1e-3);
+                if (e.hasCounters)
+                {
+                    std::fprintf(out, ",\"args\":{");
+                    for (int k=0; k<PROFILE_NUM_COUNTERS; ++k)
+                        std::fprintf(out, "%s\"%s\":%lu", k == 0 ? "" : ",", kProfileCounterNames[k], static_cast<unsigned long>(e.counters[k]));
+                    std::fprintf(out, "}");
+                }
+                std::fprintf(out, "}");
+            }
+        }
+    }
+    std::fprintf(out, "\n]}\n");
+
+    const bool ok = std::ferror(out) == 0;
+    std::fclose(out);
+    if (!ok)
+        LOGE("Error writing trace into file %s\n", filename);
+    return ok;
+}
+
+void Profile::resetZones()
+{
+    std::lock_guard<std::mutex> guard(gProfile_threadsMutex);
+    for (const std::unique_ptr<ProfileThreadBuffer>& buffer : gProfile_threads)
+        buffer->clear();
+}
+
+SR_NAMESPACE_END
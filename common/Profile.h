@@ -4,9 +4,155 @@
 #include "Logger.h"
 
 #include <chrono>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <cstdint>
 
 SR_NAMESPACE_START
 
+/// Define to 0 to compile out all SR_PROFILE_ZONE() zones
+#ifndef SR_PROFILE_ZONES
+#define SR_PROFILE_ZONES 1
+#endif
+
+#define SR_PROFILE_CONCAT_IMPL(a, b) a##b
+#define SR_PROFILE_CONCAT(a, b) SR_PROFILE_CONCAT_IMPL(a, b)
+
+#if SR_PROFILE_ZONES == 1
+///
+/// Measure the rest of the enclosing scope as zone with the name, name has to be a string literal.
+/// Zones can be nested, and used from any thread.
+#define SR_PROFILE_ZONE(name) sr::ProfileZone SR_PROFILE_CONCAT(srProfileZone_, __LINE__)(name)
+#else
+#define SR_PROFILE_ZONE(name)
+#endif
+
+///
+/// Hardware performance counters captured per zone when enabled by Profile::enableCounters()
+enum ProfileCounter
+{
+    PROFILE_COUNTER_CYCLES,
+    PROFILE_COUNTER_INSTRUCTIONS,
+    PROFILE_COUNTER_CACHE_MISSES,
+    PROFILE_COUNTER_BRANCH_MISSES,
+    PROFILE_NUM_COUNTERS
+};
+
+///
+/// Kind of recorded event
+enum class ProfileEventType
+{
+    ZONE,               // span of time measured by SR_PROFILE_ZONE()
+    FRAME_MARKER        // instant marking start of a frame, see Profile::markFrame()
+};
+
+///
+/// Single measured zone, or frame marker
+struct ProfileEvent
+{
+    ProfileEventType type;
+    // string literal as passed to SR_PROFILE_ZONE()
+    const char* name;
+    // nanoseconds since steady_clock epoch
+    std::uint64_t start;
+    std::uint64_t end;
+    // nesting level, 0 is the outermost zone of the thread
+    int depth;
+    // index of the recording thread, see ProfileThreadBuffer::getThreadIndex()
+    int thread;
+    // whether counters are captured, they include nested zones
+    bool hasCounters;
+    std::uint64_t counters[PROFILE_NUM_COUNTERS];
+};
+
+///
+/// Aggregated statistics of zones with the same name and depth on a thread, times are in microseconds.
+struct ProfileZoneStats
+{
+    std::string name;
+    // index of the thread which recorded the zones, see ProfileThreadBuffer::getThreadIndex()
+    int threadIndex;
+    int depth;
+    int count;
+    double min;
+    double mean;
+    double p99;
+    double total;
+    // mean of each counter per zone, valid only if hasCounters
+    bool hasCounters;
+    double counters[PROFILE_NUM_COUNTERS];
+};
+
+///
+/// Ring buffer of events recorded by a single thread at a time.
+///
+/// Each thread acquiring the buffer gets a new thread index which is stamped into its events, so events of
+/// threads which used the same buffer one after another are still told apart. Only the owning thread writes, and it publishes each event by advancing `head` with release semantics so
+/// no lock is taken while recording. It starts at kInitialCapacity events and doubles when full up to
+/// kCapacity, then the oldest events are overwritten.
+class ProfileThreadBuffer
+{
+public:
+    static const int kInitialCapacity = 1 << 10;
+    static const int kCapacity = 1 << 16;
+
+    ProfileThreadBuffer()
+        : depth(0)
+        , threadIndex(-1)
+        , counterGroup(kCountersNotOpened)
+        , head(0)
+    {
+        events.resize(kInitialCapacity);
+    }
+
+    ~ProfileThreadBuffer();
+
+    inline void push(const ProfileEvent& e)
+    {
+        const std::uint64_t h = head.load(std::memory_order_relaxed);
+        // events before the ring wraps are at their own index, so growing keeps them in place
+        if (h >= events.size() && events.size() < static_cast<size_t>(kCapacity))
+            events.resize(events.size() * 2);
+        events[h & (events.size() - 1)] = e;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    ///
+    /// Copy out events still held in the buffer from the oldest, return number of events overwritten
+    std::uint64_t snapshot(std::vector<ProfileEvent>& out) const;
+
+    inline void clear() { head.store(0, std::memory_order_release); }
+
+    ///
+    /// Index of the thread currently owning the buffer, threads are indexed in order they acquired a buffer
+    inline int getThreadIndex() const { return threadIndex; }
+    inline void setThreadIndex(int threadIndex_) { threadIndex = threadIndex_; }
+
+    ///
+    /// Read hardware counters of the owning thread, opening them on first call.
+    /// Return false if counters are not enabled, or not available.
+    bool readCounters(std::uint64_t out[PROFILE_NUM_COUNTERS]);
+
+    ///
+    /// Close counters of the owning thread once it exits, so the next thread using the buffer opens its own.
+    void releaseCounters();
+
+    // nesting level of the next zone, only touched by the owning thread
+    int depth;
+
+private:
+    static const int kCountersNotOpened = -2;
+    static const int kCountersUnavailable = -1;
+
+    int threadIndex;
+    // file descriptor of counter group leader, or one of kCounters* values
+    int counterGroup;
+    int counterFds[PROFILE_NUM_COUNTERS];
+    std::atomic<std::uint64_t> head;
+    std::vector<ProfileEvent> events;
+};
+
 class Profile
 {
 public:
@@ -49,8 +195,140 @@ public:
         return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - gProfile_startTime).count();
     }
 
+    ///
+    /// Return current time of zone clock in nanoseconds
+    inline static std::uint64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    ///
+    /// Return event buffer of calling thread, acquired on first call from each thread.
+    ///
+    /// Buffers stay alive until the end of program so zones can be reported after the thread exited. Once a thread
+    /// exits, its buffer is reused by the next thread acquiring one, which still records under its own thread index.
+    /// Thus spawning short-lived workers repeatedly uses only as many buffers as threads recording at once.
+    inline static ProfileThreadBuffer& threadBuffer()
+    {
+        static thread_local ThreadSlot slot;
+        return *slot.buffer;
+    }
+
+    ///
+    /// Capture hardware performance counters (cycles, instructions, cache misses, branch misses) per zone
+    /// on Linux via perf_event_open(). Each thread opens its counters on its first zone after this call.
+    /// If counters are not available i.e. restricted by kernel.perf_event_paranoid, or not running on Linux,
+    /// zones are still timed without counters. Reading counters costs a system call per zone begin and end.
+    static void enableCounters(bool enable=true);
+
+    ///
+    /// Return true if hardware counters are enabled via enableCounters()
+    inline static bool countersEnabled()
+    {
+        return gProfile_countersEnabled.load(std::memory_order_relaxed);
+    }
+
+    ///
+    /// Name the calling thread, it's shown instead of thread index in reports and exported trace.
+    static void setThreadName(const char* name);
+
+    ///
+    /// Record an instant marking start of a frame on the calling thread, shown across all threads in exported trace.
+    /// \param name String literal naming the frame
+    inline static void markFrame(const char* name="frame")
+    {
+        ProfileEvent e;
+        e.type = ProfileEventType::FRAME_MARKER;
+        e.name = name;
+        e.start = e.end = now();
+        e.depth = 0;
+        e.hasCounters = false;
+        ProfileThreadBuffer& buffer = threadBuffer();
+        e.thread = buffer.getThreadIndex();
+        buffer.push(e);
+    }
+
+    ///
+    /// Aggregate zones recorded by all threads so far, ordered by thread then by first occurrence of zone.
+    /// It should be called when no other thread is recording zones.
+    static std::vector<ProfileZoneStats> collectZones();
+
+    ///
+    /// Print count, min, mean, 99th percentile, and total time of each zone per thread to console.
+    /// It should be called when no other thread is recording zones.
+    static void report();
+
+    ///
+    /// Discard all recorded zones. It should be called when no other thread is recording zones.
+    static void resetZones();
+
+    ///
+    /// Write all zones and frame markers recorded so far as Chrome Trace Event JSON file, which can be opened
+    /// by chrome://tracing or Perfetto UI. Each thread is a track whose tid is its thread index (see
+    /// ProfileThreadBuffer::getThreadIndex()) named after setThreadName(), even if it reused buffer of an exited
+    /// thread. Zones are complete events ("X") with microsecond timestamps relative to the earliest event.
+    /// It should be called when no other thread is recording zones.
+    /// \param filename Output file name i.e. "trace.json"
+    /// \return True if successfully written, otherwise return false.
+    static bool writeChromeTrace(const char* filename);
+
 private:
+    ///
+    /// Buffer held by a thread while it's alive
+    struct ThreadSlot
+    {
+        ThreadSlot() : buffer(acquireThreadBuffer()) {}
+        ~ThreadSlot() { releaseThreadBuffer(buffer); }
+
+        ProfileThreadBuffer* buffer;
+    };
+
+    static ProfileThreadBuffer* acquireThreadBuffer();
+    static void releaseThreadBuffer(ProfileThreadBuffer* buffer);
+
     static std::chrono::steady_clock::time_point gProfile_startTime;
+    static std::atomic<bool> gProfile_countersEnabled;
+};
+
+///
+/// RAII zone recording the time from construction to destruction into event buffer of the calling thread.
+/// Use via SR_PROFILE_ZONE().
+class ProfileZone
+{
+public:
+    explicit ProfileZone(const char* name)
+        : buffer(Profile::threadBuffer())
+    {
+        event.type = ProfileEventType::ZONE;
+        event.name = name;
+        event.depth = buffer.depth++;
+        event.thread = buffer.getThreadIndex();
+        // counters are read outside of timed span so cost of reading doesn't add to zone's time
+        event.hasCounters = Profile::countersEnabled() && buffer.readCounters(event.counters);
+        event.start = Profile::now();
+    }
+
+    ~ProfileZone()
+    {
+        event.end = Profile::now();
+        std::uint64_t endCounters[PROFILE_NUM_COUNTERS];
+        if (event.hasCounters && buffer.readCounters(endCounters))
+        {
+            for (int i=0; i<PROFILE_NUM_COUNTERS; ++i)
+                event.counters[i] = endCounters[i] - event.counters[i];
+        }
+        else
+            event.hasCounters = false;
+        --buffer.depth;
+        buffer.push(event);
+    }
+
+private:
+    ProfileZone(const ProfileZone&);
+    ProfileZone& operator=(const ProfileZone&);
+
+    ProfileThreadBuffer& buffer;
+    ProfileEvent event;
 };
 
 SR_NAMESPACE_END
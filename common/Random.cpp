@@ -0,0 +1,173 @@
+#include "Random.h"
+
+#include <atomic>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+SR_NAMESPACE_START
+
+///
+/// Seed of thread generators, and number of thread generators seeded from it so far
+static std::atomic<std::uint64_t> gRandom_threadSeed(1);
+static std::atomic<std::uint64_t> gRandom_numThreads(0);
+
+///
+/// splitmix64, expand a seed into well-mixed state words
+static inline std::uint64_t splitMix64(std::uint64_t& x)
+{
+    std::uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+void Random::setSeed(std::uint64_t seed)
+{
+    std::uint64_t x = seed;
+    for (int i=0; i<4; ++i)
+        state[i] = splitMix64(x);
+    for (int word=0; word<4; ++word)
+    {
+        for (int lane=0; lane<4; lane+=2)
+        {
+            const std::uint64_t v = splitMix64(x);
+            laneState[word][lane] = static_cast<std::uint32_t>(v);
+            laneState[word][lane + 1] = static_cast<std::uint32_t>(v >> 32);
+        }
+    }
+}
+
+#if defined(__SSE2__)
+///
+/// Step 4 xoshiro128+ lanes, return their results
+static inline __m128i nextLanes(__m128i& s0, __m128i& s1, __m128i& s2, __m128i& s3)
+{
+    const __m128i result = _mm_add_epi32(s0, s3);
+    const __m128i t = _mm_slli_epi32(s1, 9);
+    s2 = _mm_xor_si128(s2, s0);
+    s3 = _mm_xor_si128(s3, s1);
+    s1 = _mm_xor_si128(s1, s2);
+    s0 = _mm_xor_si128(s0, s3);
+    s2 = _mm_xor_si128(s2, t);
+    s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+    return result;
+}
+#else
+///
+/// Step xoshiro128+ lane, return its result
+static inline std::uint32_t nextLane(std::uint32_t state[4][4], int lane)
+{
+    std::uint32_t& s0 = state[0][lane];
+    std::uint32_t& s1 = state[1][lane];
+    std::uint32_t& s2 = state[2][lane];
+    std::uint32_t& s3 = state[3][lane];
+    const std::uint32_t result = s0 + s3;
+    const std::uint32_t t = s1 << 9;
+    s2 ^= s0;
+    s3 ^= s1;
+    s1 ^= s2;
+    s0 ^= s3;
+    s2 ^= t;
+    s3 = (s3 << 11) | (s3 >> 21);
+    return result;
+}
+#endif
+
+void Random::fillFloats(float out[], int count, float min, float max)
+{
+    const float scale = (max - min) * (1.0f / 16777216.0f);
+    int i = 0;
+
+#if defined(__SSE2__)
+    __m128i s0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(laneState[0]));
+    __m128i s1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(laneState[1]));
+    __m128i s2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(laneState[2]));
+    __m128i s3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(laneState[3]));
+    const __m128 scale4 = _mm_set1_ps(scale);
+    const __m128 min4 = _mm_set1_ps(min);
+    for (; i + 4 <= count; i += 4)
+    {
+        // upper 24 bits convert exactly into float
+        const __m128i bits = _mm_srli_epi32(nextLanes(s0, s1, s2, s3), 8);
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(bits), scale4), min4));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(laneState[0]), s0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(laneState[1]), s1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(laneState[2]), s2);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(laneState[3]), s3);
+#else
+    for (; i + 4 <= count; i += 4)
+    {
+        for (int lane=0; lane<4; ++lane)
+            out[i + lane] = (nextLane(laneState, lane) >> 8) * scale + min;
+    }
+#endif
+
+    for (; i<count; ++i)
+        out[i] = nextFloat(min, max);
+}
+
+void Random::fillInts(int out[], int count, int min, int max)
+{
+    // range of 2^32 wraps around to 0, then the whole 32-bit number is used as is
+    const std::uint32_t range = static_cast<std::uint32_t>(static_cast<std::int64_t>(max) - min + 1);
+    int i = 0;
+
+#if defined(__SSE2__)
+    __m128i s0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(laneState[0]));
+    __m128i s1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(laneState[1]));
+    __m128i s2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(laneState[2]));
+    __m128i s3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(laneState[3]));
+    const __m128i range4 = _mm_set1_epi32(static_cast<int>(range));
+    const __m128i min4 = _mm_set1_epi32(min);
+    const __m128i oddMask = _mm_set_epi32(-1, 0, -1, 0);
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i bits = nextLanes(s0, s1, s2, s3);
+        __m128i scaled = bits;
+        if (range != 0)
+        {
+            // upper 32 bits of 64-bit product of random number and range, for even then odd lanes
+            const __m128i even = _mm_srli_epi64(_mm_mul_epu32(bits, range4), 32);
+            const __m128i odd = _mm_and_si128(_mm_mul_epu32(_mm_srli_epi64(bits, 32), range4), oddMask);
+            scaled = _mm_or_si128(even, odd);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_add_epi32(scaled, min4));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(laneState[0]), s0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(laneState[1]), s1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(laneState[2]), s2);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(laneState[3]), s3);
+#else
+    for (; i + 4 <= count; i += 4)
+    {
+        for (int lane=0; lane<4; ++lane)
+        {
+            const std::uint32_t bits = nextLane(laneState, lane);
+            const std::uint32_t scaled = range != 0 ? static_cast<std::uint32_t>((static_cast<std::uint64_t>(bits) * range) >> 32) : bits;
+            out[i + lane] = static_cast<int>(static_cast<std::uint32_t>(min) + scaled);
+        }
+    }
+#endif
+
+    for (; i<count; ++i)
+        out[i] = nextInt(min, max);
+}
+
+std::uint64_t Random::nextThreadSeed()
+{
+    // each thread gets a distinct seed, the same for the same order of first calls
+    std::uint64_t x = gRandom_threadSeed.load() + gRandom_numThreads.fetch_add(1) * 0x9E3779B97F4A7C15ull;
+    return splitMix64(x);
+}
+
+void Random::seedThreads(std::uint64_t seed)
+{
+    gRandom_threadSeed.store(seed);
+    gRandom_numThreads.store(0);
+    thread().setSeed(seed);
+}
+
+SR_NAMESPACE_END
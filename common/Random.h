@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Platform.h"
+
+#include <cstdint>
+
+SR_NAMESPACE_START
+
+///
+/// Pseudo-random number generator, xoshiro256** for single numbers and 4 interleaved xoshiro128+ generators
+/// for bulk fill vectorized with SSE2. The same seed always produces the same sequence.
+///
+/// It isn't thread-safe, each thread should use its own instance. Use Random::thread() for generator of the
+/// calling thread, or seed an instance per worker i.e. with base seed plus worker index to get reproducible
+/// results regardless of scheduling.
+class Random
+{
+public:
+    explicit Random(std::uint64_t seed=1)
+    {
+        setSeed(seed);
+    }
+
+    ///
+    /// Reset the sequence from seed.
+    void setSeed(std::uint64_t seed);
+
+    ///
+    /// Random 64-bit unsigned integer number
+    inline std::uint64_t next()
+    {
+        const std::uint64_t result = rotl(state[1] * 5, 7) * 9;
+        const std::uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+
+    ///
+    /// Random 32-bit unsigned integer number
+    inline std::uint32_t nextUInt()
+    {
+        return static_cast<std::uint32_t>(next() >> 32);
+    }
+
+    ///
+    /// Random integer number in range [min, max]
+    inline int nextInt(int min, int max)
+    {
+        const std::uint64_t range = static_cast<std::uint64_t>(static_cast<std::int64_t>(max) - min) + 1;
+        return static_cast<int>(min + static_cast<std::int64_t>((nextUInt() * range) >> 32));
+    }
+
+    ///
+    /// Random floating-point number in range [0.0, 1.0)
+    inline float nextFloat()
+    {
+        return (next() >> 40) * (1.0f / 16777216.0f);
+    }
+
+    ///
+    /// Random floating-point number in range [min, max)
+    inline float nextFloat(float min, float max)
+    {
+        return min + nextFloat() * (max - min);
+    }
+
+    ///
+    /// Fill array with random floating-point numbers in range [min, max).
+    /// It uses separate sequence from single number functions.
+    void fillFloats(float out[], int count, float min=0.0f, float max=1.0f);
+
+    ///
+    /// Fill array with random integer numbers in range [min, max].
+    /// It uses separate sequence from single number functions.
+    void fillInts(int out[], int count, int min, int max);
+
+    ///
+    /// Return generator of the calling thread. It's seeded on first call from each thread with seed set by
+    /// seedThreads() mixed with order of the call among threads.
+    static Random& thread()
+    {
+        static thread_local Random random(nextThreadSeed());
+        return random;
+    }
+
+    ///
+    /// Set seed of generators of threads calling thread() for the first time from now on, and reseed
+    /// generator of the calling thread with it.
+    static void seedThreads(std::uint64_t seed);
+
+private:
+    static inline std::uint64_t rotl(std::uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    static std::uint64_t nextThreadSeed();
+
+    // xoshiro256** state
+    std::uint64_t state[4];
+    // state word-major of 4 xoshiro128+ lanes, laneState[word][lane]
+    std::uint32_t laneState[4][4];
+};
+
+SR_NAMESPACE_END
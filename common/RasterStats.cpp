@@ -0,0 +1,80 @@
+#include "RasterStats.h"
+#include "Logger.h"
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+SR_NAMESPACE_START
+
+///
+/// Counters of all threads which ever rasterized, in order of registration
+static std::mutex gRasterStats_threadsMutex;
+static std::vector<std::unique_ptr<RasterStats>> gRasterStats_threads;
+
+RasterStats* registerRasterStatsThread()
+{
+    std::lock_guard<std::mutex> guard(gRasterStats_threadsMutex);
+    gRasterStats_threads.emplace_back(new RasterStats());
+    return gRasterStats_threads.back().get();
+}
+
+RasterStats collectRasterStats(bool reset)
+{
+    std::lock_guard<std::mutex> guard(gRasterStats_threadsMutex);
+    RasterStats merged;
+    for (const std::unique_ptr<RasterStats>& stats : gRasterStats_threads)
+    {
+        merged.merge(*stats);
+        if (reset)
+            stats->reset();
+    }
+    return merged;
+}
+
+///
+/// Return part / total in percent, or 0 if total is 0.
+static inline double percent(std::uint64_t part, std::uint64_t total)
+{
+    return total > 0 ? 100.0 * part / total : 0.0;
+}
+
+void printRasterStats(const RasterStats& stats)
+{
+    LOG("%s\n", "Raster stats");
+    LOG("  triangles submitted %12lu\n", static_cast<unsigned long>(stats.trianglesSubmitted));
+    LOG("  triangles culled    %12lu (%.1f%%)\n", static_cast<unsigned long>(stats.trianglesCulled), percent(stats.trianglesCulled, stats.trianglesSubmitted));
+    LOG("  triangles clipped   %12lu (%.1f%%)\n", static_cast<unsigned long>(stats.trianglesClipped), percent(stats.trianglesClipped, stats.trianglesSubmitted));
+    LOG("  pixels tested       %12lu\n", static_cast<unsigned long>(stats.pixelsTested));
+    LOG("  pixels passed depth %12lu (%.1f%%)\n", static_cast<unsigned long>(stats.pixelsPassed), percent(stats.pixelsPassed, stats.pixelsTested));
+    LOG("  pixels shaded       %12lu (%.1f%%)\n", static_cast<unsigned long>(stats.pixelsShaded), percent(stats.pixelsShaded, stats.pixelsTested));
+}
+
+void overdrawHeatmap(const OverdrawMap& map, sr::FrameBuffer& fb)
+{
+    const int size = map.getWidth() * map.getHeight();
+    const unsigned int* counts = map.getCounts();
+    const unsigned int maxCount = *std::max_element(counts, counts + size);
+    unsigned int* pixels = fb.getFrameBuffer();
+
+    for (int i=0; i<size; ++i)
+    {
+        if (counts[i] == 0)
+        {
+            pixels[i] = 0xFF000000;
+            continue;
+        }
+
+        // 0 for shaded once, 1 for the most shaded, then blue -> green over the first half, green -> red over the second
+        const float t = maxCount > 1 ? static_cast<float>(counts[i] - 1) / (maxCount - 1) : 0.0f;
+        const float rise = std::min(1.0f, 2.0f * t);
+        const float fall = std::max(0.0f, 2.0f * t - 1.0f);
+        const unsigned int r = static_cast<unsigned int>(fall * 255.0f + 0.5f);
+        const unsigned int g = static_cast<unsigned int>((rise - fall) * 255.0f + 0.5f);
+        const unsigned int b = static_cast<unsigned int>((1.0f - rise) * 255.0f + 0.5f);
+        pixels[i] = 0xFF000000 | (r << 16) | (g << 8) | b;
+    }
+}
+
+SR_NAMESPACE_END
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "Platform.h"
+#include "FrameBuffer.h"
+#include "AlignedAllocator.h"
+
+#include <cstdint>
+
+SR_NAMESPACE_START
+
+/// Define to 1 for the whole build i.e. with -DSR_RASTER_STATS=1 in CXXFLAGS to count triangles and pixels
+/// going through rasterization. With 0, counting code is compiled out and costs nothing.
+#ifndef SR_RASTER_STATS
+#define SR_RASTER_STATS 0
+#endif
+
+#if SR_RASTER_STATS == 1
+///
+/// Add `n` to counter of RasterStats of the calling thread
+#define SR_RASTER_STAT_ADD(counter, n) (sr::threadRasterStats().counter += (n))
+#else
+#define SR_RASTER_STAT_ADD(counter, n)
+#endif
+
+///
+/// Counters of triangles and pixels going through rasterization.
+struct RasterStats
+{
+    // triangles passed to triangle setup
+    std::uint64_t trianglesSubmitted;
+    // triangles discarded before rasterization, degenerated, outside of viewport, or by face culling
+    std::uint64_t trianglesCulled;
+    // triangles rasterized but partially outside of viewport, so their bounding box is clipped
+    std::uint64_t trianglesClipped;
+    // pixels inside triangles (any of samples for MSAA), tested against depth
+    std::uint64_t pixelsTested;
+    // pixels passing depth test (any of covered samples for MSAA)
+    std::uint64_t pixelsPassed;
+    // pixels whose fragment isn't discarded, and written into framebuffer
+    std::uint64_t pixelsShaded;
+
+    RasterStats()
+    {
+        reset();
+    }
+
+    inline void reset()
+    {
+        trianglesSubmitted = 0;
+        trianglesCulled = 0;
+        trianglesClipped = 0;
+        pixelsTested = 0;
+        pixelsPassed = 0;
+        pixelsShaded = 0;
+    }
+
+    inline void merge(const RasterStats& other)
+    {
+        trianglesSubmitted += other.trianglesSubmitted;
+        trianglesCulled += other.trianglesCulled;
+        trianglesClipped += other.trianglesClipped;
+        pixelsTested += other.pixelsTested;
+        pixelsPassed += other.pixelsPassed;
+        pixelsShaded += other.pixelsShaded;
+    }
+};
+
+///
+/// Number of shaded fragments per pixel, bound to a thread by setThreadOverdrawMap() to be counted by
+/// rasterization kernels when SR_RASTER_STATS is enabled. It has to have the same width as framebuffer being drawn.
+class OverdrawMap
+{
+public:
+    OverdrawMap(int width, int height)
+        : width(width)
+        , height(height)
+    {
+        counts.resize(width * height);
+        clear();
+    }
+
+    inline void clear()
+    {
+        sr::firstTouch(&counts[0], counts.size(), 0u, 1);
+    }
+
+    inline void increment(int index)
+    {
+        ++counts[index];
+    }
+
+    ///
+    /// Add counts of other map of the same size i.e. one counted by another thread.
+    inline void merge(const OverdrawMap& other)
+    {
+        for (size_t i=0; i<counts.size(); ++i)
+            counts[i] += other.counts[i];
+    }
+
+    inline unsigned int get(int x, int y) const { return counts[x + y*width]; }
+    inline const unsigned int* getCounts() const { return &counts[0]; }
+    inline int getWidth() const { return width; }
+    inline int getHeight() const { return height; }
+
+private:
+    int width;
+    int height;
+
+    sr::AlignedVector<unsigned int> counts;
+};
+
+///
+/// Create counters of the calling thread, and register them to be merged by collectRasterStats().
+/// Use threadRasterStats() instead.
+RasterStats* registerRasterStatsThread();
+
+///
+/// Return counters of the calling thread. They're registered on first call from each thread, and
+/// stay alive until the end of program so they can be merged after the thread exited.
+inline RasterStats& threadRasterStats()
+{
+    static thread_local RasterStats* stats = registerRasterStatsThread();
+    return *stats;
+}
+
+///
+/// Return overdraw map bound to the calling thread, or nullptr if none is bound.
+inline OverdrawMap*& threadOverdrawMap()
+{
+    static thread_local OverdrawMap* map = nullptr;
+    return map;
+}
+
+///
+/// Bind overdraw map to the calling thread, pass nullptr to stop counting overdraw.
+inline void setThreadOverdrawMap(OverdrawMap* map)
+{
+    threadOverdrawMap() = map;
+}
+
+///
+/// Merge counters of all threads, then optionally reset them. Call it at the end of frame when
+/// no other thread is rasterizing.
+RasterStats collectRasterStats(bool reset=true);
+
+///
+/// Print counters to console.
+void printRasterStats(const RasterStats& stats);
+
+///
+/// Convert overdraw map into heatmap, pixel never shaded is black, then color goes from blue (shaded once)
+/// through green to red (the most shaded pixel of the map).
+/// \param map Input overdraw map
+/// \param fb Output framebuffer, must have the same size as the map
+void overdrawHeatmap(const OverdrawMap& map, sr::FrameBuffer& fb);
+
+SR_NAMESPACE_END
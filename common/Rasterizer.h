@@ -0,0 +1,490 @@
+#pragma once
+
+#include "Platform.h"
+#include "Types.h"
+#include "RasterStats.h"
+
+#include <cmath>
+#include <algorithm>
+
+SR_NAMESPACE_START
+
+///
+/// Depth test function used in rasterization. Greater depth value is closer to the viewer.
+enum class DepthTest
+{
+    GREATER,        // pass if closer than stored depth, then write depth
+    EQUAL           // pass if equal to stored depth as laid down by depth pre-pass, depth is not written
+};
+
+///
+/// Whether fragment passing depth test writes its depth into z-buffer
+enum class DepthWrite
+{
+    ENABLED,
+    DISABLED        // i.e. translucent fragments, which are tested against opaque geometry but don't occlude
+};
+
+///
+/// Plane equation of a value across screen space, v(x, y) = a*x + b*y + c
+struct PlaneEquation
+{
+    float a;
+    float b;
+    float c;
+
+    inline float eval(float x, float y) const
+    {
+        return a*x + b*y + c;
+    }
+};
+
+///
+/// Fixed number of floating-point attributes (varyings) carried by a vertex i.e. uv, normal, or color.
+/// Zero number of attributes is allowed.
+template <int N>
+struct Varyings
+{
+    static const int kNum = N;
+
+    float v[N > 0 ? N : 1];
+
+    inline float& operator[](int i) { return v[i]; }
+    inline float operator[](int i) const { return v[i]; }
+};
+
+///
+/// Per-triangle setup for rasterization.
+///
+/// It computes edge functions, depth plane, and plane equations for `N` attributes once per triangle
+/// so rasterization only needs to step them incrementally across each span.
+/// Attributes are interpolated in perspective-correct manner, planes are set up for attribute/w and 1/w
+/// which are linear in screen space, then divided back per pixel.
+///
+/// Input position is in screen space (x, y in pixels), z is depth value in which greater value is
+/// closer to the viewer, and w is clip-space w before perspective division (1.0 for orthographic projection).
+/// Pixel is sampled at its integer position. Pixel lying exactly on the edge shared by two triangles is
+/// rasterized only once (top-left rule).
+template <int N>
+struct TriangleSetup
+{
+    static const int kNumVaryings = N;
+
+    // bounding box clipped to viewport
+    int minX;
+    int minY;
+    int maxX;
+    int maxY;
+
+    // edge functions, each one is positive inside the triangle
+    PlaneEquation edges[3];
+    // whether pixel lying exactly on the edge is inside
+    bool edgeInclusive[3];
+    // whether vertices are in counter-clockwise order on screen
+    bool frontFacing;
+
+    PlaneEquation depth;
+    PlaneEquation invW;
+    PlaneEquation varyings[N > 0 ? N : 1];
+
+    ///
+    /// Set up the triangle.
+    ///
+    /// \param pos Screen space position of 3 vertices
+    /// \param attributes Attributes of 3 vertices. Can be nullptr if N is zero.
+    /// \param width Width of the viewport
+    /// \param height Height of the viewport
+    /// \param sampleExtent Farthest distance on each axis from pixel position to any sample of the pixel.
+    /// Bounding box is grown by it, so triangle covering only samples but no pixel position isn't culled.
+    /// Use kMSAASampleExtent for multisample rasterization.
+    /// \return Return false if triangle is degenerated or lies completely outside of viewport, otherwise return true.
+    bool setup(const sr::Vec4f pos[3], const sr::Varyings<N> attributes[3], int width, int height, float sampleExtent=0.0f)
+    {
+        SR_RASTER_STAT_ADD(trianglesSubmitted, 1);
+
+        const int boundMinX = static_cast<int>(std::ceil(std::min(std::min(pos[0].x, pos[1].x), pos[2].x) - sampleExtent));
+        const int boundMinY = static_cast<int>(std::ceil(std::min(std::min(pos[0].y, pos[1].y), pos[2].y) - sampleExtent));
+        const int boundMaxX = static_cast<int>(std::floor(std::max(std::max(pos[0].x, pos[1].x), pos[2].x) + sampleExtent));
+        const int boundMaxY = static_cast<int>(std::floor(std::max(std::max(pos[0].y, pos[1].y), pos[2].y) + sampleExtent));
+        minX = std::max(0, boundMinX);
+        minY = std::max(0, boundMinY);
+        maxX = std::min(width - 1, boundMaxX);
+        maxY = std::min(height - 1, boundMaxY);
+        if (minX > maxX || minY > maxY)
+        {
+            SR_RASTER_STAT_ADD(trianglesCulled, 1);
+            return false;
+        }
+
+        // edge i is opposite to vertex i, so edge i evaluated at vertex i equals to twice the signed area
+        for (int i=0; i<3; ++i)
+        {
+            const sr::Vec4f& v1 = pos[(i+1)%3];
+            const sr::Vec4f& v2 = pos[(i+2)%3];
+            edges[i].a = v1.y - v2.y;
+            edges[i].b = v2.x - v1.x;
+            edges[i].c = v1.x*v2.y - v2.x*v1.y;
+        }
+
+        float area = edges[0].eval(pos[0].x, pos[0].y);
+        if (area == 0.0f)
+        {
+            SR_RASTER_STAT_ADD(trianglesCulled, 1);
+            return false;
+        }
+#if SR_RASTER_STATS == 1
+        if (minX != boundMinX || minY != boundMinY || maxX != boundMaxX || maxY != boundMaxY)
+            SR_RASTER_STAT_ADD(trianglesClipped, 1);
+#endif
+        frontFacing = area > 0.0f;
+        // accept both windings, flip edges so inside is always positive
+        if (area < 0.0f)
+        {
+            for (int i=0; i<3; ++i)
+            {
+                edges[i].a = -edges[i].a;
+                edges[i].b = -edges[i].b;
+                edges[i].c = -edges[i].c;
+            }
+            area = -area;
+        }
+
+        // top-left rule; two triangles sharing an edge see it with opposite normal, so only one includes it
+        for (int i=0; i<3; ++i)
+            edgeInclusive[i] = edges[i].a > 0.0f || (edges[i].a == 0.0f && edges[i].b > 0.0f);
+
+        // value at vertex interpolated via barycentric coordinate (edge / area) becomes a plane
+        const float invArea = 1.0f / area;
+        float invWs[3];
+        for (int i=0; i<3; ++i)
+            invWs[i] = 1.0f / pos[i].w;
+
+        depth = interpolationPlane(pos[0].z, pos[1].z, pos[2].z, invArea);
+        invW = interpolationPlane(invWs[0], invWs[1], invWs[2], invArea);
+        for (int k=0; k<N; ++k)
+        {
+            varyings[k] = interpolationPlane(attributes[0][k] * invWs[0],
+                                             attributes[1][k] * invWs[1],
+                                             attributes[2][k] * invWs[2],
+                                             invArea);
+        }
+
+        return true;
+    }
+
+    ///
+    /// Return true if position with input edge function values is inside the triangle.
+    inline bool inside(float e0, float e1, float e2) const
+    {
+        return (e0 > 0.0f || (e0 == 0.0f && edgeInclusive[0])) &&
+               (e1 > 0.0f || (e1 == 0.0f && edgeInclusive[1])) &&
+               (e2 > 0.0f || (e2 == 0.0f && edgeInclusive[2]));
+    }
+
+private:
+    inline PlaneEquation interpolationPlane(float v0, float v1, float v2, float invArea) const
+    {
+        PlaneEquation p;
+        p.a = (edges[0].a*v0 + edges[1].a*v1 + edges[2].a*v2) * invArea;
+        p.b = (edges[0].b*v0 + edges[1].b*v1 + edges[2].b*v2) * invArea;
+        p.c = (edges[0].c*v0 + edges[1].c*v1 + edges[2].c*v2) * invArea;
+        return p;
+    }
+};
+
+///
+/// Rasterize the triangle which is already set up with z-buffer testing.
+///
+/// Edge functions, depth, and attribute planes are stepped incrementally along each row of the bounding box.
+/// For every pixel passing the depth test, perspective-correct attributes are reconstructed then
+/// `fragment` is called as `bool fragment(int x, int y, int index, const sr::Varyings<N>& varyings)`
+/// in which `index` is the pixel index into row-major buffer with `width` as its line size.
+/// `fragment` returns false to discard the fragment. Depth of fragment not discarded is written unless
+/// `Write` is DepthWrite::DISABLED, and it's counted as shaded either way.
+///
+/// With DepthTest::EQUAL, only fragment whose depth equals to the one written by rasterizeTriangleDepth()
+/// for the same triangle setup passes. Depth is computed in the exact same sequence of operations in both
+/// kernels so the result is bit-identical.
+///
+/// \param setup Triangle setup
+/// \param zBuffer Depth buffer, greater value is closer
+/// \param width Line size of depth buffer
+/// \param fragment Callable object to process each fragment
+template <sr::DepthTest Test=sr::DepthTest::GREATER, sr::DepthWrite Write=sr::DepthWrite::ENABLED, int N, typename FragmentFunc>
+inline void rasterizeTriangle(const TriangleSetup<N>& setup, float zBuffer[], int width, FragmentFunc&& fragment)
+{
+    const float startX = static_cast<float>(setup.minX);
+    sr::Varyings<N> varyings;
+    float varyingsOverW[N > 0 ? N : 1];
+
+#if SR_RASTER_STATS == 1
+    // counted locally, then added to counters of the thread once per triangle
+    std::uint64_t tested = 0;
+    std::uint64_t passed = 0;
+    std::uint64_t shaded = 0;
+    sr::OverdrawMap* overdraw = sr::threadOverdrawMap();
+#endif
+
+    for (int y=setup.minY; y<=setup.maxY; ++y)
+    {
+        const float fy = static_cast<float>(y);
+
+        // evaluate once at the start of the span, then step along x
+        float e0 = setup.edges[0].eval(startX, fy);
+        float e1 = setup.edges[1].eval(startX, fy);
+        float e2 = setup.edges[2].eval(startX, fy);
+        float z = setup.depth.eval(startX, fy);
+        float invW = setup.invW.eval(startX, fy);
+        for (int k=0; k<N; ++k)
+            varyingsOverW[k] = setup.varyings[k].eval(startX, fy);
+
+        bool entered = false;
+        int index = setup.minX + y*width;
+        for (int x=setup.minX; x<=setup.maxX; ++x, ++index)
+        {
+            if (setup.inside(e0, e1, e2))
+            {
+                entered = true;
+                const bool depthPassed = Test == sr::DepthTest::EQUAL ? zBuffer[index] == z : zBuffer[index] < z;
+#if SR_RASTER_STATS == 1
+                ++tested;
+#endif
+                if (depthPassed)
+                {
+                    const float w = 1.0f / invW;
+                    for (int k=0; k<N; ++k)
+                        varyings[k] = varyingsOverW[k] * w;
+
+                    const bool shadedFragment = fragment(x, y, index, varyings);
+                    if (shadedFragment && Test == sr::DepthTest::GREATER && Write == sr::DepthWrite::ENABLED)
+                        zBuffer[index] = z;
+#if SR_RASTER_STATS == 1
+                    ++passed;
+                    if (shadedFragment)
+                    {
+                        ++shaded;
+                        if (overdraw != nullptr)
+                            overdraw->increment(index);
+                    }
+#endif
+                }
+            }
+            // triangle is convex, nothing left on this row once we left it
+            else if (entered)
+                break;
+
+            e0 += setup.edges[0].a;
+            e1 += setup.edges[1].a;
+            e2 += setup.edges[2].a;
+            z += setup.depth.a;
+            invW += setup.invW.a;
+            for (int k=0; k<N; ++k)
+                varyingsOverW[k] += setup.varyings[k].a;
+        }
+    }
+
+#if SR_RASTER_STATS == 1
+    sr::RasterStats& stats = sr::threadRasterStats();
+    stats.pixelsTested += tested;
+    stats.pixelsPassed += passed;
+    stats.pixelsShaded += shaded;
+#endif
+}
+
+///
+/// Number of samples per pixel of multisample rasterization
+const int kMSAANumSamples = 4;
+
+///
+/// Farthest distance on each axis from pixel position to its multisample sample
+const float kMSAASampleExtent = 0.375f;
+
+///
+/// Rasterize the triangle which is already set up with 4x multisampling and per-sample z-buffer testing.
+///
+/// Coverage and depth are evaluated at 4 sample positions of rotated grid around each pixel's integer position,
+/// so near-horizontal and near-vertical edges get 4 distinct levels of coverage. Attributes are interpolated
+/// only once at the pixel position, and `fragment` is called once per pixel as
+/// `bool fragment(int x, int y, int index, unsigned int coverage, const sr::Varyings<N>& varyings)`
+/// in which bit `s` of `coverage` is set if sample `s` is inside the triangle and passes the depth test.
+/// Sample `s` of pixel `index` is at `index * kMSAANumSamples + s` of the depth buffer.
+/// Depth of covered samples is written only if `fragment` returns true.
+/// Triangle must be set up with kMSAASampleExtent, so its bounding box includes pixels covered only by samples.
+///
+/// \param setup Triangle setup
+/// \param zBuffer Depth buffer with kMSAANumSamples values per pixel, greater value is closer
+/// \param width Line size of depth buffer in pixels
+/// \param fragment Callable object to process each pixel covered by at least one sample
+template <int N, typename FragmentFunc>
+inline void rasterizeTriangleMSAA(const TriangleSetup<N>& setup, float zBuffer[], int width, FragmentFunc&& fragment)
+{
+    // D3D standard 4x pattern, each sample has distinct row and column
+    static const float kSampleX[kMSAANumSamples] = { -0.125f, 0.375f, -0.375f, 0.125f };
+    static const float kSampleY[kMSAANumSamples] = { -0.375f, -0.125f, 0.125f, 0.375f };
+
+    // offset of edge functions and depth from pixel position to each sample, computed once per triangle
+    float edgeOffsets[3][kMSAANumSamples];
+    float depthOffsets[kMSAANumSamples];
+    float edgeRejects[3];
+    for (int i=0; i<3; ++i)
+    {
+        for (int s=0; s<kMSAANumSamples; ++s)
+            edgeOffsets[i][s] = setup.edges[i].a*kSampleX[s] + setup.edges[i].b*kSampleY[s];
+        // no sample can be inside if edge function at the pixel is below the largest negative offset
+        edgeRejects[i] = -kMSAASampleExtent * (std::abs(setup.edges[i].a) + std::abs(setup.edges[i].b));
+    }
+    for (int s=0; s<kMSAANumSamples; ++s)
+        depthOffsets[s] = setup.depth.a*kSampleX[s] + setup.depth.b*kSampleY[s];
+
+    const int minX = setup.minX;
+    const int minY = setup.minY;
+    const int maxX = setup.maxX;
+    const int maxY = setup.maxY;
+    const float startX = static_cast<float>(minX);
+
+    sr::Varyings<N> varyings;
+    float varyingsOverW[N > 0 ? N : 1];
+
+#if SR_RASTER_STATS == 1
+    std::uint64_t tested = 0;
+    std::uint64_t passed = 0;
+    std::uint64_t shaded = 0;
+    sr::OverdrawMap* overdraw = sr::threadOverdrawMap();
+#endif
+
+    for (int y=minY; y<=maxY; ++y)
+    {
+        const float fy = static_cast<float>(y);
+
+        float e0 = setup.edges[0].eval(startX, fy);
+        float e1 = setup.edges[1].eval(startX, fy);
+        float e2 = setup.edges[2].eval(startX, fy);
+        float z = setup.depth.eval(startX, fy);
+        float invW = setup.invW.eval(startX, fy);
+        for (int k=0; k<N; ++k)
+            varyingsOverW[k] = setup.varyings[k].eval(startX, fy);
+
+        int index = minX + y*width;
+        for (int x=minX; x<=maxX; ++x, ++index)
+        {
+            if (e0 >= edgeRejects[0] && e1 >= edgeRejects[1] && e2 >= edgeRejects[2])
+            {
+                float* depths = zBuffer + index*kMSAANumSamples;
+                unsigned int inside = 0;
+                unsigned int coverage = 0;
+                for (int s=0; s<kMSAANumSamples; ++s)
+                {
+                    if (setup.inside(e0 + edgeOffsets[0][s], e1 + edgeOffsets[1][s], e2 + edgeOffsets[2][s]))
+                    {
+                        inside |= 1u << s;
+                        if (depths[s] < z + depthOffsets[s])
+                            coverage |= 1u << s;
+                    }
+                }
+#if SR_RASTER_STATS == 1
+                tested += inside != 0;
+                passed += coverage != 0;
+#else
+                (void)inside;
+#endif
+
+                if (coverage != 0)
+                {
+                    // shade once per pixel, attributes may be extrapolated if pixel position itself is outside
+                    const float w = 1.0f / invW;
+                    for (int k=0; k<N; ++k)
+                        varyings[k] = varyingsOverW[k] * w;
+
+                    if (fragment(x, y, index, coverage, varyings))
+                    {
+                        for (int s=0; s<kMSAANumSamples; ++s)
+                        {
+                            if (coverage & (1u << s))
+                                depths[s] = z + depthOffsets[s];
+                        }
+#if SR_RASTER_STATS == 1
+                        ++shaded;
+                        if (overdraw != nullptr)
+                            overdraw->increment(index);
+#endif
+                    }
+                }
+            }
+
+            e0 += setup.edges[0].a;
+            e1 += setup.edges[1].a;
+            e2 += setup.edges[2].a;
+            z += setup.depth.a;
+            invW += setup.invW.a;
+            for (int k=0; k<N; ++k)
+                varyingsOverW[k] += setup.varyings[k].a;
+        }
+    }
+
+#if SR_RASTER_STATS == 1
+    sr::RasterStats& stats = sr::threadRasterStats();
+    stats.pixelsTested += tested;
+    stats.pixelsPassed += passed;
+    stats.pixelsShaded += shaded;
+#endif
+}
+
+///
+/// Rasterize the triangle which is already set up into depth buffer only.
+///
+/// This is the kernel of depth pre-pass. Nothing but edge functions and depth is stepped, and no
+/// fragment is processed. Follow with rasterizeTriangle() using DepthTest::EQUAL to shade only the
+/// visible fragments.
+///
+/// \param setup Triangle setup
+/// \param zBuffer Depth buffer, greater value is closer
+/// \param width Line size of depth buffer
+template <int N>
+inline void rasterizeTriangleDepth(const TriangleSetup<N>& setup, float zBuffer[], int width)
+{
+    const float startX = static_cast<float>(setup.minX);
+#if SR_RASTER_STATS == 1
+    std::uint64_t tested = 0;
+    std::uint64_t passed = 0;
+#endif
+
+    for (int y=setup.minY; y<=setup.maxY; ++y)
+    {
+        const float fy = static_cast<float>(y);
+
+        float e0 = setup.edges[0].eval(startX, fy);
+        float e1 = setup.edges[1].eval(startX, fy);
+        float e2 = setup.edges[2].eval(startX, fy);
+        float z = setup.depth.eval(startX, fy);
+
+        bool entered = false;
+        int index = setup.minX + y*width;
+        for (int x=setup.minX; x<=setup.maxX; ++x, ++index)
+        {
+            if (setup.inside(e0, e1, e2))
+            {
+                entered = true;
+#if SR_RASTER_STATS == 1
+                ++tested;
+                passed += zBuffer[index] < z;
+#endif
+                zBuffer[index] = std::max(zBuffer[index], z);
+            }
+            else if (entered)
+                break;
+
+            e0 += setup.edges[0].a;
+            e1 += setup.edges[1].a;
+            e2 += setup.edges[2].a;
+            z += setup.depth.a;
+        }
+    }
+
+#if SR_RASTER_STATS == 1
+    sr::RasterStats& stats = sr::threadRasterStats();
+    stats.pixelsTested += tested;
+    stats.pixelsPassed += passed;
+#endif
+}
+
+SR_NAMESPACE_END
@@ -3,10 +3,27 @@
 #include "Platform.h"
 #include "Logger.h"
 #include "Types.h"
+#include "Vec3Packet.h"
 #include "Profile.h"
 #include "TGAImage.h"
 #include "MathUtil.h"
+#include "Random.h"
 #include "GraphicsUtil.h"
 #include "Graphics.h"
+#include "Rasterizer.h"
+#include "Shader.h"
+#include "GBuffer.h"
+#include "OITBuffer.h"
+#include "MSAABuffer.h"
+#include "RasterStats.h"
+#include "MeshGenerator.h"
 #include "ObjLoader.h"
+#include "FaceLighting.h"
 #include "FrameBuffer.h"
+#include "DepthBuffer.h"
+#include "HDRFrameBuffer.h"
+#include "Blend.h"
+#include "AlignedAllocator.h"
+#include "Parallel.h"
+#include "MemoryLayout.h"
+#include "Texture2D.h"
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "Platform.h"
+#include "Types.h"
+#include "FrameBuffer.h"
+#include "Rasterizer.h"
+#include "Blend.h"
+
+SR_NAMESPACE_START
+
+///
+/// Which faces to discard before rasterization
+enum class CullMode
+{
+    NONE,
+    BACK,       // discard clockwise faces on screen
+    FRONT       // discard counter-clockwise faces on screen
+};
+
+///
+/// Base of programmable shader with `N` varyings passing from vertex to fragment stage.
+///
+/// Shader is supplied as template parameter to drawing functions, so calls into it are resolved at
+/// compile time and inlined into the rasterization loop instead of going through virtual call per fragment.
+/// The base only supplies types, derived shader has to implement
+///
+///  - `void vertex(int face, int vert, sr::Vec4f& outPos, sr::Varyings<N>& outVaryings)`
+///    to output screen space position (see TriangleSetup) and varyings of vertex `vert` [0-2] of face `face`.
+///    It is called for vertex 0, 1, and 2 in order for each face.
+///  - `bool fragment(int x, int y, const sr::Varyings<N>& varyings, sr::Color32i& outColor)`
+///    to output color of the fragment. Return false to discard the fragment.
+template <int N>
+struct Shader
+{
+    static const int kNumVaryings = N;
+    typedef sr::Varyings<N> varyings_type;
+};
+
+///
+/// Run vertex stage of the shader for input face then set up the triangle for rasterization.
+/// Return false if the face is culled, degenerated, or outside of viewport.
+/// `sampleExtent` is passed to TriangleSetup::setup(), it's kMSAASampleExtent for multisample rasterization.
+template <typename ShaderT>
+inline bool setupFace(ShaderT& shader, int face, int width, int height, CullMode cull, sr::TriangleSetup<ShaderT::kNumVaryings>& setup, float sampleExtent=0.0f)
+{
+    sr::Vec4f pos[3];
+    sr::Varyings<ShaderT::kNumVaryings> varyings[3];
+    for (int j=0; j<3; ++j)
+        shader.vertex(face, j, pos[j], varyings[j]);
+
+    if (!setup.setup(pos, varyings, width, height, sampleExtent))
+        return false;
+    if ((cull == CullMode::BACK && !setup.frontFacing) ||
+        (cull == CullMode::FRONT && setup.frontFacing))
+    {
+        SR_RASTER_STAT_ADD(trianglesCulled, 1);
+        return false;
+    }
+    return true;
+}
+
+///
+/// Index of rasterized pixel into framebuffer storage. `index` is the row-major index also used for z-buffer,
+/// so it's used as is for linear framebuffer.
+inline int pixelIndex(const sr::LinearLayout&, int, int, int index)
+{
+    return index;
+}
+
+template <typename Layout>
+inline int pixelIndex(const Layout& layout, int x, int y, int)
+{
+    return layout.index(x, y);
+}
+
+///
+/// Implementation of drawTriangles() with depth test function and blend mode known at compile time.
+template <sr::DepthTest Test, sr::BlendMode Mode, typename ShaderT, typename Layout>
+inline void drawTrianglesWithDepthTest(ShaderT& shader, int numFaces, sr::FrameBufferT<Layout>& fb, float zBuffer[], CullMode cull)
+{
+    const int kNumVaryings = ShaderT::kNumVaryings;
+    const int width = fb.getWidth();
+    const int height = fb.getHeight();
+    unsigned int* pixels = fb.getFrameBuffer();
+    const Layout& layout = fb.getLayout();
+
+    sr::TriangleSetup<kNumVaryings> setup;
+    for (int i=0; i<numFaces; ++i)
+    {
+        if (!setupFace(shader, i, width, height, cull, setup))
+            continue;
+
+        sr::rasterizeTriangle<Test>(setup, zBuffer, width, [&shader, pixels, &layout](int x, int y, int index, const sr::Varyings<kNumVaryings>& varyings) -> bool {
+            sr::Color32i color;
+            if (!shader.fragment(x, y, varyings, color))
+                return false;
+            // output stage
+            unsigned int& pixel = pixels[sr::pixelIndex(layout, x, y, index)];
+            pixel = sr::blend<Mode>(color.packed, pixel);
+            return true;
+        });
+    }
+}
+
+///
+/// Dispatch drawTrianglesWithDepthTest() for blend mode.
+template <sr::DepthTest Test, typename ShaderT, typename Layout>
+inline void drawTrianglesWithBlend(ShaderT& shader, int numFaces, sr::FrameBufferT<Layout>& fb, float zBuffer[], CullMode cull, sr::BlendMode blendMode)
+{
+    switch (blendMode)
+    {
+        case sr::BlendMode::REPLACE:
+            drawTrianglesWithDepthTest<Test, sr::BlendMode::REPLACE>(shader, numFaces, fb, zBuffer, cull);
+            break;
+        case sr::BlendMode::SRC_OVER:
+            drawTrianglesWithDepthTest<Test, sr::BlendMode::SRC_OVER>(shader, numFaces, fb, zBuffer, cull);
+            break;
+        case sr::BlendMode::ADDITIVE:
+            drawTrianglesWithDepthTest<Test, sr::BlendMode::ADDITIVE>(shader, numFaces, fb, zBuffer, cull);
+            break;
+        case sr::BlendMode::MULTIPLY:
+            drawTrianglesWithDepthTest<Test, sr::BlendMode::MULTIPLY>(shader, numFaces, fb, zBuffer, cull);
+            break;
+        case sr::BlendMode::PREMULTIPLIED:
+            drawTrianglesWithDepthTest<Test, sr::BlendMode::PREMULTIPLIED>(shader, numFaces, fb, zBuffer, cull);
+            break;
+    }
+}
+
+///
+/// Draw triangles with the shader and z-buffer testing.
+///
+/// \param shader Shader to process vertices and fragments
+/// \param numFaces Number of faces to draw. Faces [0, numFaces) are passed to the vertex stage.
+/// \param fb Color framebuffer of any memory layout
+/// \param zBuffer Depth buffer, greater value is closer. It's always row-major.
+/// \param cull Face culling mode
+/// \param depthTest Depth test function. Use sr::DepthTest::EQUAL after drawTrianglesDepth() to run
+/// fragment stage only once per pixel for the visible fragment.
+/// \param blendMode How fragment color is blended into framebuffer. Depth is still written for blended fragment,
+/// so translucent triangles should be drawn after opaque ones from far to near.
+template <typename ShaderT, typename Layout>
+void drawTriangles(ShaderT& shader, int numFaces, sr::FrameBufferT<Layout>& fb, float zBuffer[], CullMode cull=CullMode::NONE, sr::DepthTest depthTest=sr::DepthTest::GREATER, sr::BlendMode blendMode=sr::BlendMode::REPLACE)
+{
+    if (depthTest == sr::DepthTest::EQUAL)
+        drawTrianglesWithBlend<sr::DepthTest::EQUAL>(shader, numFaces, fb, zBuffer, cull, blendMode);
+    else
+        drawTrianglesWithBlend<sr::DepthTest::GREATER>(shader, numFaces, fb, zBuffer, cull, blendMode);
+}
+
+///
+/// Draw triangles into z-buffer only (depth pre-pass). Only vertex stage of the shader is run.
+///
+/// \param shader Shader to process vertices
+/// \param numFaces Number of faces to draw
+/// \param width Width of z-buffer
+/// \param height Height of z-buffer
+/// \param zBuffer Depth buffer, greater value is closer
+/// \param cull Face culling mode, it should be the same as of the following color pass
+template <typename ShaderT>
+void drawTrianglesDepth(ShaderT& shader, int numFaces, int width, int height, float zBuffer[], CullMode cull=CullMode::NONE)
+{
+    sr::TriangleSetup<ShaderT::kNumVaryings> setup;
+    for (int i=0; i<numFaces; ++i)
+    {
+        if (setupFace(shader, i, width, height, cull, setup))
+            sr::rasterizeTriangleDepth(setup, zBuffer, width);
+    }
+}
+
+SR_NAMESPACE_END
@@ -5,6 +5,7 @@
 
 #include <iostream>
 #include <cstring>
+#include <vector>
 
 SR_NAMESPACE_START
 
@@ -19,6 +20,17 @@ public:
         return write24(filename, fb.getFrameBuffer(), fb.getWidth(), fb.getHeight(), flipY);
     }
 
+    ///
+    /// Write RGB (24-bit) image .tga image from framebuffer with non-linear memory layout.
+    /// Pixels are resolved into row-major order first.
+    template <typename Layout>
+    static bool write24(const char* filename, const sr::FrameBufferT<Layout>& fb, bool flipY=false)
+    {
+        std::vector<unsigned int> pixels(fb.getWidth() * fb.getHeight());
+        fb.resolve(&pixels[0]);
+        return write24(filename, &pixels[0], fb.getWidth(), fb.getHeight(), flipY);
+    }
+
     ///
     /// Write RGB (24-bit) image .tga image from raw pixels pointer in RGB or ARGB format.
     static bool write24(const char* filename, const unsigned int* frameBuffer, int width, int height, bool flipY=false)
@@ -0,0 +1,257 @@
+#pragma once
+
+#include "Platform.h"
+#include "Logger.h"
+#include "MemoryLayout.h"
+#include "GraphicsUtil.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+SR_NAMESPACE_START
+
+///
+/// Filtering mode used in sampling texture
+enum class TextureFilter
+{
+    NEAREST,
+    BILINEAR,
+    TRILINEAR
+};
+
+///
+/// 2D texture of 32-bit ARGB texels with mipmap chain.
+///
+/// Texels are not stored in row-major order, but according to `Layout` policy (see MemoryLayout.h)
+/// which defaults to 4x4 tiles. This keeps neighbor texels fetched by bilinear filtering, and texels
+/// fetched by adjacent pixels along any direction in the same cache line.
+///
+/// Width and height must be power of two. Texture coordinate wraps around (repeat).
+template <typename Layout = sr::TiledLayout<4>>
+class Texture2D
+{
+public:
+    struct Level
+    {
+        int width;
+        int height;
+        Layout layout;
+        std::vector<unsigned int> texels;
+
+        Level(int width_, int height_)
+            : width(width_)
+            , height(height_)
+            , layout(width_, height_)
+        {
+            texels.resize(layout.size(), 0x0);
+        }
+
+        inline unsigned int fetch(int x, int y) const
+        {
+            return texels[layout.index(x & (width-1), y & (height-1))];
+        }
+    };
+
+public:
+    Texture2D() = default;
+
+    ///
+    /// Create texture from row-major ARGB pixels.
+    ///
+    /// \param pixels Row-major pixels in ARGB format
+    /// \param width Width of the texture, must be power of two
+    /// \param height Height of the texture, must be power of two
+    /// \param generateMipmaps Whether or not to generate full mipmap chain down to 1x1
+    /// \return Return true if successfully created, otherwise return false.
+    bool create(const unsigned int* pixels, int width, int height, bool generateMipmaps=true)
+    {
+        if (!isPowerOfTwo(width) || !isPowerOfTwo(height))
+        {
+            LOGE("texture dimension must be power of two (%d x %d)\n", width, height);
+            return false;
+        }
+
+        levels.clear();
+
+        std::vector<unsigned int> linear(pixels, pixels + width*height);
+        std::vector<unsigned int> linearNext;
+        addLevel(linear, width, height);
+
+        if (generateMipmaps)
+        {
+            while (width > 1 || height > 1)
+            {
+                const int nextWidth = std::max(1, width >> 1);
+                const int nextHeight = std::max(1, height >> 1);
+                linearNext.resize(nextWidth * nextHeight);
+                downsample(linear.data(), width, height, linearNext.data(), nextWidth, nextHeight);
+
+                linear.swap(linearNext);
+                width = nextWidth;
+                height = nextHeight;
+                addLevel(linear, width, height);
+            }
+        }
+
+        return true;
+    }
+
+    ///
+    /// Sample texture at normalized texture coordinate.
+    ///
+    /// \param u Horizontal texture coordinate, [0.0, 1.0] covers the whole texture
+    /// \param v Vertical texture coordinate, [0.0, 1.0] covers the whole texture
+    /// \param filter Filtering mode
+    /// \param lod Level of detail, 0.0 is the base level. Only used by TextureFilter::TRILINEAR, see computeLod().
+    /// \return Filtered texel in ARGB format.
+    inline unsigned int sample(float u, float v, TextureFilter filter=TextureFilter::BILINEAR, float lod=0.0f) const
+    {
+        switch (filter)
+        {
+        case TextureFilter::NEAREST: return sampleNearest(levels[0], u, v);
+        case TextureFilter::BILINEAR: return sampleBilinear(levels[0], u, v);
+        case TextureFilter::TRILINEAR: return sampleTrilinear(u, v, lod);
+        }
+        return 0;
+    }
+
+    ///
+    /// Sample with nearest filtering on specified mip level.
+    inline unsigned int sampleNearest(int level, float u, float v) const
+    {
+        return sampleNearest(levels[level], u, v);
+    }
+
+    ///
+    /// Sample with bilinear filtering on specified mip level.
+    inline unsigned int sampleBilinear(int level, float u, float v) const
+    {
+        return sampleBilinear(levels[level], u, v);
+    }
+
+    ///
+    /// Sample with bilinear filtering on two nearest mip levels then blend between them.
+    inline unsigned int sampleTrilinear(float u, float v, float lod) const
+    {
+        const float maxLod = static_cast<float>(levels.size() - 1);
+        lod = std::min(std::max(lod, 0.0f), maxLod);
+        const int level0 = static_cast<int>(lod);
+        const int level1 = std::min(level0 + 1, static_cast<int>(levels.size()) - 1);
+        const unsigned int t = static_cast<unsigned int>((lod - level0) * 256.0f);
+
+        const unsigned int c0 = sampleBilinear(levels[level0], u, v);
+        if (level0 == level1 || t == 0)
+            return c0;
+        return sr::lerpColorPacked(c0, sampleBilinear(levels[level1], u, v), t);
+    }
+
+    ///
+    /// Compute level of detail from screen-space derivatives of normalized texture coordinate.
+    inline float computeLod(float dudx, float dvdx, float dudy, float dvdy) const
+    {
+        const float w = static_cast<float>(levels[0].width);
+        const float h = static_cast<float>(levels[0].height);
+        const float lenX = (dudx*w)*(dudx*w) + (dvdx*h)*(dvdx*h);
+        const float lenY = (dudy*w)*(dudy*w) + (dvdy*h)*(dvdy*h);
+        // log2(sqrt(x)) = 0.5*log2(x)
+        return 0.5f * std::log2(std::max(std::max(lenX, lenY), 1.0f));
+    }
+
+    inline int getWidth() const { return levels[0].width; }
+    inline int getHeight() const { return levels[0].height; }
+    inline int getNumLevels() const { return static_cast<int>(levels.size()); }
+    inline const Level& getLevel(int level) const { return levels[level]; }
+
+private:
+    void addLevel(const std::vector<unsigned int>& linear, int width, int height)
+    {
+        levels.emplace_back(width, height);
+        Level& level = levels.back();
+        for (int y=0; y<height; ++y)
+        {
+            for (int x=0; x<width; ++x)
+                level.texels[level.layout.index(x, y)] = linear[x + y*width];
+        }
+    }
+
+    ///
+    /// 2x2 box filter of row-major source into row-major destination.
+    /// If one of the axes is already 1, only the other axis is filtered.
+    static void downsample(const unsigned int* src, int srcWidth, int srcHeight, unsigned int* dst, int dstWidth, int dstHeight)
+    {
+        for (int y=0; y<dstHeight; ++y)
+        {
+            const unsigned int* row0 = src + (std::min(2*y, srcHeight-1)) * srcWidth;
+            const unsigned int* row1 = src + (std::min(2*y+1, srcHeight-1)) * srcWidth;
+            unsigned int* dstRow = dst + y*dstWidth;
+            int x = 0;
+
+#if defined(__SSE2__)
+            // 2 destination texels per iteration, source components widened to 16-bit
+            if (srcWidth > 1)
+            {
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i round = _mm_set1_epi16(2);
+                for (; x + 2 <= dstWidth; x += 2)
+                {
+                    const __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2*x));
+                    const __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2*x));
+                    const __m128i sumLo = _mm_add_epi16(_mm_unpacklo_epi8(r0, zero), _mm_unpacklo_epi8(r1, zero));
+                    const __m128i sumHi = _mm_add_epi16(_mm_unpackhi_epi8(r0, zero), _mm_unpackhi_epi8(r1, zero));
+                    __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(sumLo, sumHi), _mm_unpackhi_epi64(sumLo, sumHi));
+                    sum = _mm_srli_epi16(_mm_add_epi16(sum, round), 2);
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(dstRow + x), _mm_packus_epi16(sum, sum));
+                }
+            }
+#endif
+
+            for (; x<dstWidth; ++x)
+            {
+                const int x0 = std::min(2*x, srcWidth-1);
+                const int x1 = std::min(2*x+1, srcWidth-1);
+                const unsigned int p[4] = { row0[x0], row0[x1], row1[x0], row1[x1] };
+                unsigned int result = 0;
+                for (int shift=0; shift<32; shift+=8)
+                {
+                    unsigned int sum = 2;
+                    for (int i=0; i<4; ++i)
+                        sum += (p[i] >> shift) & 0xFF;
+                    result |= (sum >> 2) << shift;
+                }
+                dstRow[x] = result;
+            }
+        }
+    }
+
+    static inline unsigned int sampleNearest(const Level& level, float u, float v)
+    {
+        return level.fetch(static_cast<int>(std::floor(u * level.width)), static_cast<int>(std::floor(v * level.height)));
+    }
+
+    static inline unsigned int sampleBilinear(const Level& level, float u, float v)
+    {
+        // texel centers are at half-texel offset
+        const float x = u * level.width - 0.5f;
+        const float y = v * level.height - 0.5f;
+        const float fx = std::floor(x);
+        const float fy = std::floor(y);
+        const int x0 = static_cast<int>(fx);
+        const int y0 = static_cast<int>(fy);
+        const unsigned int tx = static_cast<unsigned int>((x - fx) * 256.0f);
+        const unsigned int ty = static_cast<unsigned int>((y - fy) * 256.0f);
+
+        const unsigned int top = sr::lerpColorPacked(level.fetch(x0, y0), level.fetch(x0+1, y0), tx);
+        const unsigned int bottom = sr::lerpColorPacked(level.fetch(x0, y0+1), level.fetch(x0+1, y0+1), tx);
+        return sr::lerpColorPacked(top, bottom, ty);
+    }
+
+private:
+    std::vector<Level> levels;
+};
+
+SR_NAMESPACE_END
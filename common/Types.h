@@ -137,17 +137,17 @@ struct SR_MEM_ALIGN(16) Vec4
     {
         struct
         {
-            int b;
-            int g;
-            int r;
-            int a;
+            T b;
+            T g;
+            T r;
+            T a;
         };
         struct
         {
-            int x;
-            int y;
-            int z;
-            int w;
+            T x;
+            T y;
+            T z;
+            T w;
         };
     };
 
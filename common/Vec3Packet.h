@@ -0,0 +1,347 @@
+#pragma once
+
+#include "Platform.h"
+#include "Types.h"
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+SR_NAMESPACE_START
+
+static_assert(sizeof(sr::Vec3f) == 16, "Vec3f is expected to be padded to 16 bytes for transposed load and store");
+
+///
+/// 4 floating-point numbers processed together, SSE register or plain array without SSE2.
+struct Float_x4
+{
+    static const int kWidth = 4;
+
+#if defined(__SSE2__)
+    __m128 v;
+
+    Float_x4() {}
+    explicit Float_x4(__m128 v_) : v(v_) {}
+
+    static inline Float_x4 set1(float s) { return Float_x4(_mm_set1_ps(s)); }
+    static inline Float_x4 load(const float src[]) { return Float_x4(_mm_loadu_ps(src)); }
+    inline void store(float dst[]) const { _mm_storeu_ps(dst, v); }
+#else
+    float v[4];
+
+    static inline Float_x4 set1(float s) { Float_x4 r; for (int i=0; i<4; ++i) r.v[i] = s; return r; }
+    static inline Float_x4 load(const float src[]) { Float_x4 r; for (int i=0; i<4; ++i) r.v[i] = src[i]; return r; }
+    inline void store(float dst[]) const { for (int i=0; i<4; ++i) dst[i] = v[i]; }
+#endif
+};
+
+#if defined(__SSE2__)
+inline Float_x4 operator+(Float_x4 a, Float_x4 b) { return Float_x4(_mm_add_ps(a.v, b.v)); }
+inline Float_x4 operator-(Float_x4 a, Float_x4 b) { return Float_x4(_mm_sub_ps(a.v, b.v)); }
+inline Float_x4 operator*(Float_x4 a, Float_x4 b) { return Float_x4(_mm_mul_ps(a.v, b.v)); }
+inline Float_x4 min(Float_x4 a, Float_x4 b) { return Float_x4(_mm_min_ps(a.v, b.v)); }
+inline Float_x4 max(Float_x4 a, Float_x4 b) { return Float_x4(_mm_max_ps(a.v, b.v)); }
+inline Float_x4 sqrt(Float_x4 a) { return Float_x4(_mm_sqrt_ps(a.v)); }
+///
+/// Approximate 1/sqrt(a) refined by one Newton-Raphson step, relative error is about 1e-7
+inline Float_x4 rsqrt(Float_x4 a)
+{
+    const __m128 y = _mm_rsqrt_ps(a.v);
+    const __m128 halfAyy = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), a.v), _mm_mul_ps(y, y));
+    return Float_x4(_mm_mul_ps(y, _mm_sub_ps(_mm_set1_ps(1.5f), halfAyy)));
+}
+#else
+#define SR_FLOAT_X4_OP(expr) Float_x4 r; for (int i=0; i<4; ++i) r.v[i] = (expr); return r;
+inline Float_x4 operator+(Float_x4 a, Float_x4 b) { SR_FLOAT_X4_OP(a.v[i] + b.v[i]) }
+inline Float_x4 operator-(Float_x4 a, Float_x4 b) { SR_FLOAT_X4_OP(a.v[i] - b.v[i]) }
+inline Float_x4 operator*(Float_x4 a, Float_x4 b) { SR_FLOAT_X4_OP(a.v[i] * b.v[i]) }
+inline Float_x4 min(Float_x4 a, Float_x4 b) { SR_FLOAT_X4_OP(std::min(a.v[i], b.v[i])) }
+inline Float_x4 max(Float_x4 a, Float_x4 b) { SR_FLOAT_X4_OP(std::max(a.v[i], b.v[i])) }
+inline Float_x4 sqrt(Float_x4 a) { SR_FLOAT_X4_OP(std::sqrt(a.v[i])) }
+inline Float_x4 rsqrt(Float_x4 a) { SR_FLOAT_X4_OP(1.0f / std::sqrt(a.v[i])) }
+#undef SR_FLOAT_X4_OP
+#endif
+
+///
+/// 8 floating-point numbers processed together, AVX register or two Float_x4 without AVX.
+struct Float_x8
+{
+    static const int kWidth = 8;
+
+#if defined(__AVX__)
+    __m256 v;
+
+    Float_x8() {}
+    explicit Float_x8(__m256 v_) : v(v_) {}
+
+    static inline Float_x8 set1(float s) { return Float_x8(_mm256_set1_ps(s)); }
+    static inline Float_x8 load(const float src[]) { return Float_x8(_mm256_loadu_ps(src)); }
+    inline void store(float dst[]) const { _mm256_storeu_ps(dst, v); }
+#else
+    Float_x4 lo;
+    Float_x4 hi;
+
+    Float_x8() {}
+    Float_x8(Float_x4 lo_, Float_x4 hi_) : lo(lo_), hi(hi_) {}
+
+    static inline Float_x8 set1(float s) { return Float_x8(Float_x4::set1(s), Float_x4::set1(s)); }
+    static inline Float_x8 load(const float src[]) { return Float_x8(Float_x4::load(src), Float_x4::load(src + 4)); }
+    inline void store(float dst[]) const { lo.store(dst); hi.store(dst + 4); }
+#endif
+};
+
+#if defined(__AVX__)
+inline Float_x8 operator+(Float_x8 a, Float_x8 b) { return Float_x8(_mm256_add_ps(a.v, b.v)); }
+inline Float_x8 operator-(Float_x8 a, Float_x8 b) { return Float_x8(_mm256_sub_ps(a.v, b.v)); }
+inline Float_x8 operator*(Float_x8 a, Float_x8 b) { return Float_x8(_mm256_mul_ps(a.v, b.v)); }
+inline Float_x8 min(Float_x8 a, Float_x8 b) { return Float_x8(_mm256_min_ps(a.v, b.v)); }
+inline Float_x8 max(Float_x8 a, Float_x8 b) { return Float_x8(_mm256_max_ps(a.v, b.v)); }
+inline Float_x8 sqrt(Float_x8 a) { return Float_x8(_mm256_sqrt_ps(a.v)); }
+///
+/// Approximate 1/sqrt(a) refined by one Newton-Raphson step, relative error is about 1e-7
+inline Float_x8 rsqrt(Float_x8 a)
+{
+    const __m256 y = _mm256_rsqrt_ps(a.v);
+    const __m256 halfAyy = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), a.v), _mm256_mul_ps(y, y));
+    return Float_x8(_mm256_mul_ps(y, _mm256_sub_ps(_mm256_set1_ps(1.5f), halfAyy)));
+}
+#else
+inline Float_x8 operator+(Float_x8 a, Float_x8 b) { return Float_x8(a.lo + b.lo, a.hi + b.hi); }
+inline Float_x8 operator-(Float_x8 a, Float_x8 b) { return Float_x8(a.lo - b.lo, a.hi - b.hi); }
+inline Float_x8 operator*(Float_x8 a, Float_x8 b) { return Float_x8(a.lo * b.lo, a.hi * b.hi); }
+inline Float_x8 min(Float_x8 a, Float_x8 b) { return Float_x8(min(a.lo, b.lo), min(a.hi, b.hi)); }
+inline Float_x8 max(Float_x8 a, Float_x8 b) { return Float_x8(max(a.lo, b.lo), max(a.hi, b.hi)); }
+inline Float_x8 sqrt(Float_x8 a) { return Float_x8(sqrt(a.lo), sqrt(a.hi)); }
+inline Float_x8 rsqrt(Float_x8 a) { return Float_x8(rsqrt(a.lo), rsqrt(a.hi)); }
+#endif
+
+///
+/// Packet of Float_x4::kWidth or Float_x8::kWidth 3d vectors in SoA form, each component of all vectors is in
+/// its own register so math on the packet processes all vectors with the same instructions as one vector.
+/// Use Vec3f_x4 or Vec3f_x8, then loadVec3fPacket() and storeVec3fPacket() to convert from and to Vec3f array.
+template <typename F>
+struct Vec3Packet
+{
+    static const int kWidth = F::kWidth;
+
+    F x;
+    F y;
+    F z;
+
+    Vec3Packet() {}
+    Vec3Packet(F x_, F y_, F z_) : x(x_), y(y_), z(z_) {}
+
+    ///
+    /// Packet with all vectors equal to `v`
+    static inline Vec3Packet<F> broadcast(const sr::Vec3f& v)
+    {
+        return Vec3Packet<F>(F::set1(v.x), F::set1(v.y), F::set1(v.z));
+    }
+
+    ///
+    /// Normalize all vectors, zero vector stays zero.
+    inline void normalize()
+    {
+        const F invLength = rsqrt(max(x*x + y*y + z*z, F::set1(1e-30f)));
+        x = x * invLength;
+        y = y * invLength;
+        z = z * invLength;
+    }
+};
+
+typedef Vec3Packet<Float_x4> Vec3f_x4;
+typedef Vec3Packet<Float_x8> Vec3f_x8;
+
+template <typename F>
+inline Vec3Packet<F> operator+(const Vec3Packet<F>& a, const Vec3Packet<F>& b)
+{
+    return Vec3Packet<F>(a.x + b.x, a.y + b.y, a.z + b.z);
+}
+
+template <typename F>
+inline Vec3Packet<F> operator-(const Vec3Packet<F>& a, const Vec3Packet<F>& b)
+{
+    return Vec3Packet<F>(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+template <typename F>
+inline Vec3Packet<F> operator*(const Vec3Packet<F>& a, const Vec3Packet<F>& b)
+{
+    return Vec3Packet<F>(a.x * b.x, a.y * b.y, a.z * b.z);
+}
+
+///
+/// Scale each vector by its own scalar
+template <typename F>
+inline Vec3Packet<F> operator*(const Vec3Packet<F>& a, F s)
+{
+    return Vec3Packet<F>(a.x * s, a.y * s, a.z * s);
+}
+
+template <typename F>
+inline F dot(const Vec3Packet<F>& u, const Vec3Packet<F>& v)
+{
+    return u.x*v.x + u.y*v.y + u.z*v.z;
+}
+
+template <typename F>
+inline Vec3Packet<F> cross(const Vec3Packet<F>& u, const Vec3Packet<F>& v)
+{
+    return Vec3Packet<F>(u.y*v.z - u.z*v.y, u.z*v.x - u.x*v.z, u.x*v.y - u.y*v.x);
+}
+
+template <typename F>
+inline F squaredLength(const Vec3Packet<F>& v)
+{
+    return dot(v, v);
+}
+
+template <typename F>
+inline F length(const Vec3Packet<F>& v)
+{
+    return sqrt(dot(v, v));
+}
+
+///
+/// Load 4 vectors from src[0, 4) transposing them into SoA form.
+inline void loadVec3fPacket(const sr::Vec3f src[], Vec3f_x4& out)
+{
+#if defined(__SSE2__)
+    __m128 r0 = _mm_loadu_ps(&src[0].x);
+    __m128 r1 = _mm_loadu_ps(&src[1].x);
+    __m128 r2 = _mm_loadu_ps(&src[2].x);
+    __m128 r3 = _mm_loadu_ps(&src[3].x);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    out = Vec3f_x4(Float_x4(r0), Float_x4(r1), Float_x4(r2));
+#else
+    for (int i=0; i<4; ++i)
+    {
+        out.x.v[i] = src[i].x;
+        out.y.v[i] = src[i].y;
+        out.z.v[i] = src[i].z;
+    }
+#endif
+}
+
+///
+/// Store 4 vectors in SoA form into dst[0, 4), padding component of Vec3f is overwritten.
+inline void storeVec3fPacket(const Vec3f_x4& v, sr::Vec3f dst[])
+{
+#if defined(__SSE2__)
+    __m128 r0 = v.x.v;
+    __m128 r1 = v.y.v;
+    __m128 r2 = v.z.v;
+    __m128 r3 = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_storeu_ps(&dst[0].x, r0);
+    _mm_storeu_ps(&dst[1].x, r1);
+    _mm_storeu_ps(&dst[2].x, r2);
+    _mm_storeu_ps(&dst[3].x, r3);
+#else
+    for (int i=0; i<4; ++i)
+    {
+        dst[i].x = v.x.v[i];
+        dst[i].y = v.y.v[i];
+        dst[i].z = v.z.v[i];
+    }
+#endif
+}
+
+///
+/// Load 8 vectors from src[0, 8) transposing them into SoA form.
+inline void loadVec3fPacket(const sr::Vec3f src[], Vec3f_x8& out)
+{
+#if defined(__AVX__)
+    // vector i in lower half, vector i+4 in upper half, then transpose both halves at once
+    const __m256 r0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&src[0].x)), _mm_loadu_ps(&src[4].x), 1);
+    const __m256 r1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&src[1].x)), _mm_loadu_ps(&src[5].x), 1);
+    const __m256 r2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&src[2].x)), _mm_loadu_ps(&src[6].x), 1);
+    const __m256 r3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&src[3].x)), _mm_loadu_ps(&src[7].x), 1);
+    const __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    const __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+    const __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+    const __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+    out = Vec3f_x8(Float_x8(_mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0))),
+                   Float_x8(_mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2))),
+                   Float_x8(_mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0))));
+#else
+    Vec3f_x4 lo;
+    Vec3f_x4 hi;
+    loadVec3fPacket(src, lo);
+    loadVec3fPacket(src + 4, hi);
+    out = Vec3f_x8(Float_x8(lo.x, hi.x), Float_x8(lo.y, hi.y), Float_x8(lo.z, hi.z));
+#endif
+}
+
+///
+/// Store 8 vectors in SoA form into dst[0, 8), padding component of Vec3f is overwritten.
+inline void storeVec3fPacket(const Vec3f_x8& v, sr::Vec3f dst[])
+{
+#if defined(__AVX__)
+    const __m256 t0 = _mm256_unpacklo_ps(v.x.v, v.y.v);
+    const __m256 t1 = _mm256_unpackhi_ps(v.x.v, v.y.v);
+    const __m256 t2 = _mm256_unpacklo_ps(v.z.v, _mm256_setzero_ps());
+    const __m256 t3 = _mm256_unpackhi_ps(v.z.v, _mm256_setzero_ps());
+    const __m256 rows[4] = {
+        _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)),
+        _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)),
+        _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)),
+        _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2))
+    };
+    for (int i=0; i<4; ++i)
+    {
+        _mm_storeu_ps(&dst[i].x, _mm256_castps256_ps128(rows[i]));
+        _mm_storeu_ps(&dst[i + 4].x, _mm256_extractf128_ps(rows[i], 1));
+    }
+#else
+    storeVec3fPacket(Vec3f_x4(v.x.lo, v.y.lo, v.z.lo), dst);
+    storeVec3fPacket(Vec3f_x4(v.x.hi, v.y.hi, v.z.hi), dst + 4);
+#endif
+}
+
+///
+/// Load vectors [index, index + kWidth) of `src` into packet, vectors past the end of `src` are zero.
+template <typename F>
+inline Vec3Packet<F> loadVec3fPacket(const std::vector<sr::Vec3f>& src, size_t index)
+{
+    const int kWidth = Vec3Packet<F>::kWidth;
+    Vec3Packet<F> out;
+    if (index + kWidth <= src.size())
+    {
+        loadVec3fPacket(&src[index], out);
+    }
+    else
+    {
+        sr::Vec3f tail[kWidth];
+        std::copy(src.begin() + index, src.end(), tail);
+        loadVec3fPacket(tail, out);
+    }
+    return out;
+}
+
+///
+/// Store packet into vectors [index, index + kWidth) of `dst`, vectors past the end of `dst` are skipped.
+template <typename F>
+inline void storeVec3fPacket(const Vec3Packet<F>& v, std::vector<sr::Vec3f>& dst, size_t index)
+{
+    const int kWidth = Vec3Packet<F>::kWidth;
+    if (index + kWidth <= dst.size())
+    {
+        storeVec3fPacket(v, &dst[index]);
+    }
+    else
+    {
+        sr::Vec3f tail[kWidth];
+        storeVec3fPacket(v, tail);
+        std::copy(tail, tail + (dst.size() - index), dst.begin() + index);
+    }
+}
+
+SR_NAMESPACE_END